@@ -0,0 +1,25 @@
+"""Fairy-Stockfish Python wrapper.
+
+The engine is built once per CPU architecture and the fastest build the CPU
+supports is loaded. The environment variable PYFFISH_ARCH selects a build,
+e.g. PYFFISH_ARCH=x86-64 for the generic one. The loaded build is in arch.
+"""
+
+import importlib
+import os
+
+from ._cpu import supported_archs
+
+
+def _load():
+    archs = [os.environ["PYFFISH_ARCH"]] if os.environ.get("PYFFISH_ARCH") else supported_archs() + ["generic"]
+    for arch in archs:
+        try:
+            return importlib.import_module("._" + arch.replace("-", "_"), __name__)
+        except ImportError:
+            continue
+    raise ImportError("No build of pyffish for any of {}".format(", ".join(archs)))
+
+
+_module = _load()
+globals().update({name: value for name, value in vars(_module).items() if not name.startswith("__")})
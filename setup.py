@@ -1,13 +1,19 @@
 # -*- coding: utf-8 -*-
 
 from setuptools import setup, Extension
+from setuptools.command.build_ext import build_ext
+try:
+    from setuptools.modified import newer_group
+except ImportError:
+    from distutils.dep_util import newer_group
 from glob import glob
 import platform
 import io
 import os
 
 
-if platform.python_compiler().startswith("MSC"):
+msvc = platform.python_compiler().startswith("MSC")
+if msvc:
     args = ["/std:c++17"]
 else:
     args = ["-std=c++17", "-flto", "-Wno-date-time"]
@@ -17,6 +23,64 @@ args.extend(["-DLARGEBOARDS", "-DPRECOMPUTED_MAGICS", "-DNNUE_EMBEDDING_OFF"])
 if "64bit" in platform.architecture():
     args.append("-DIS_64BIT")
 
+# POSIX shared memory lives in librt on older glibc versions
+libraries = ["rt"] if platform.system() == "Linux" else []
+
+# On x86-64, the engine is built once per architecture of the Makefile below and the pyffish
+# package loads the fastest one the CPU supports. Other targets get a single generic build.
+# Cross builds, e.g. for arm64 on macOS, are recognized by ARCHFLAGS.
+x86_64 = (platform.machine().lower() in ("x86_64", "amd64")
+          and "64bit" in platform.architecture()
+          and "arm64" not in os.environ.get("ARCHFLAGS", ""))
+
+if not x86_64:
+    ARCHS = {"generic": []}
+elif msvc:
+    sse41_popcnt = ["/DUSE_POPCNT", "/DUSE_SSE41", "/DUSE_SSSE3", "/DUSE_SSE2"]
+    ARCHS = {
+        "x86-64": ["/DUSE_SSE2"],
+        "x86-64-sse41-popcnt": sse41_popcnt,
+        "x86-64-avx2": sse41_popcnt + ["/arch:AVX2", "/DUSE_AVX2"],
+        "x86-64-bmi2": sse41_popcnt + ["/arch:AVX2", "/DUSE_AVX2", "/DUSE_PEXT"],
+    }
+else:
+    sse41_popcnt = ["-msse3", "-mpopcnt", "-DUSE_POPCNT", "-msse4.1", "-DUSE_SSE41",
+                    "-mssse3", "-DUSE_SSSE3", "-msse2", "-DUSE_SSE2"]
+    ARCHS = {
+        "x86-64": ["-msse2", "-DUSE_SSE2"],
+        "x86-64-sse41-popcnt": sse41_popcnt,
+        "x86-64-avx2": sse41_popcnt + ["-mavx2", "-mbmi", "-DUSE_AVX2"],
+        "x86-64-bmi2": sse41_popcnt + ["-mavx2", "-mbmi", "-DUSE_AVX2", "-mbmi2", "-DUSE_PEXT"],
+    }
+
+
+class BuildExt(build_ext):
+    """Keeps the objects of each extension apart, since the builds for all
+    architectures compile the same sources with different flags. The directory
+    is passed to the compiler instead of changing build_temp, which is shared by
+    the extensions built in parallel."""
+
+    def build_extension(self, ext):
+        ext_path = self.get_ext_fullpath(ext.name)
+        if not (self.force or newer_group(ext.sources + ext.depends, ext_path, "newer")):
+            return
+
+        build_temp = os.path.join(self.build_temp, ext.name)
+        macros = ext.define_macros + [(undef,) for undef in ext.undef_macros]
+        objects = self.compiler.compile(ext.sources, output_dir=build_temp, macros=macros,
+                                        include_dirs=ext.include_dirs, debug=self.debug,
+                                        extra_postargs=ext.extra_compile_args or [],
+                                        depends=ext.depends)
+        self.compiler.link_shared_object(objects + (ext.extra_objects or []), ext_path,
+                                         libraries=self.get_libraries(ext),
+                                         library_dirs=ext.library_dirs,
+                                         runtime_library_dirs=ext.runtime_library_dirs,
+                                         extra_postargs=ext.extra_link_args or [],
+                                         export_symbols=self.get_export_symbols(ext),
+                                         debug=self.debug, build_temp=build_temp,
+                                         target_lang=self.compiler.detect_language(ext.sources))
+
+
 CLASSIFIERS = [
     "Development Status :: 3 - Alpha",
     "License :: OSI Approved :: GNU General Public License v3 (GPLv3)",
@@ -34,10 +98,19 @@ try:
 except ValueError:
     print(f"ffish_source_file {ffish_source_file} was not found in sources {sources}.")
 
-pyffish_module = Extension(
-    "pyffish",
-    sources=sources,
-    extra_compile_args=args)
+cpu_source_file = os.path.normcase("src/pyffish_cpu.cpp")
+sources.remove(cpu_source_file)
+sources.remove(os.path.normcase("src/fat.cpp"))
+
+modules = [Extension("pyffish._cpu", sources=[cpu_source_file], extra_compile_args=args[:1])]
+for arch, arch_args in ARCHS.items():
+    module_name = "_" + arch.replace("-", "_")
+    modules.append(Extension(
+        "pyffish." + module_name,
+        sources=sources,
+        libraries=libraries,
+        define_macros=[("PYFFISH_MODULE", module_name), ("PYFFISH_ARCH", '"{}"'.format(arch))],
+        extra_compile_args=args + arch_args))
 
 setup(name="pyffish", version="0.0.75",
       description="Fairy-Stockfish Python wrapper",
@@ -49,5 +122,7 @@ setup(name="pyffish", version="0.0.75",
       classifiers=CLASSIFIERS,
       url="https://github.com/gbtami/Fairy-Stockfish",
       python_requires=">=2.7,!=3.0.*,!=3.1.*,!=3.2.*,!=3.3.*",
-      ext_modules=[pyffish_module]
+      packages=["pyffish"],
+      ext_modules=modules,
+      cmdclass={"build_ext": BuildExt}
       )
@@ -19,17 +19,25 @@
 #ifndef APIUTIL_H_INCLUDED
 #define APIUTIL_H_INCLUDED
 
+#include <algorithm>
 #include <array>
+#include <deque>
+#include <optional>
+#include <set>
+#include <memory>
 #include <vector>
 #include <string>
+#include <string_view>
 #include <sstream>
 #include <cctype>
 #include <iostream>
 #include <math.h>
 
+#include "fen.h"
 #include "types.h"
 #include "position.h"
 #include "variant.h"
+#include "uci.h"
 
 namespace Stockfish {
 
@@ -199,7 +207,10 @@ inline std::string square(const Position& pos, Square s, Notation n) {
     }
 }
 
-inline Disambiguation disambiguation_level(const Position& pos, Move m, Notation n) {
+// The origin squares of the other pieces that can make the same move
+// are only requested if the notation needs them.
+template<typename OtherOrigins>
+inline Disambiguation disambiguation_level(const Position& pos, Move m, Notation n, OtherOrigins other_origins) {
     // Drops never need disambiguation
     if (type_of(m) == DROP)
         return NO_DISAMBIGUATION;
@@ -239,20 +250,7 @@ inline Disambiguation disambiguation_level(const Position& pos, Move m, Notation
 
     // A disambiguation occurs if we have more then one piece of type 'pt'
     // that can reach 'to' with a legal move.
-    Bitboard b = pos.pieces(us, pt) ^ from;
-    Bitboard others = 0;
-
-    while (b)
-    {
-        Square s = pop_lsb(b);
-        // Construct a potential move with identical special move flags
-        // and only a different "from" square.
-        Move testMove = Move(m ^ make_move(from, to) ^ make_move(s, to));
-        if (      pos.pseudo_legal(testMove)
-               && pos.legal(testMove)
-               && !(is_shogi(n) && pos.unpromoted_piece_on(s) != pos.unpromoted_piece_on(from)))
-            others |= s;
-    }
+    Bitboard others = other_origins();
 
     if (!others)
         return NO_DISAMBIGUATION;
@@ -266,6 +264,29 @@ inline Disambiguation disambiguation_level(const Position& pos, Move m, Notation
         return SQUARE_DISAMBIGUATION;
 }
 
+inline Disambiguation disambiguation_level(const Position& pos, Move m, Notation n) {
+    return disambiguation_level(pos, m, n, [&]() {
+        Color us = pos.side_to_move();
+        Square from = from_sq(m);
+        Square to = to_sq(m);
+        Bitboard b = pos.pieces(us, type_of(pos.moved_piece(m))) ^ from;
+        Bitboard others = 0;
+
+        while (b)
+        {
+            Square s = pop_lsb(b);
+            // Construct a potential move with identical special move flags
+            // and only a different "from" square.
+            Move testMove = Move(m ^ make_move(from, to) ^ make_move(s, to));
+            if (      pos.pseudo_legal(testMove)
+                   && pos.legal(testMove)
+                   && !(is_shogi(n) && pos.unpromoted_piece_on(s) != pos.unpromoted_piece_on(from)))
+                others |= s;
+        }
+        return others;
+    });
+}
+
 inline std::string disambiguation(const Position& pos, Square s, Notation n, Disambiguation d) {
     switch (d)
     {
@@ -281,7 +302,21 @@ inline std::string disambiguation(const Position& pos, Square s, Notation n, Dis
     }
 }
 
-inline const std::string move_to_san(Position& pos, Move m, Notation n) {
+// Whether the side to move has a legal move, without generating all of them
+inline bool has_legal_move(const Position& pos) {
+    if (pos.is_immediate_game_end())
+        return false;
+
+    ExtMove moveList[MAX_MOVES];
+    ExtMove* end = pos.checkers() ? generate<EVASIONS>(pos, moveList) : generate<NON_EVASIONS>(pos, moveList);
+    for (ExtMove* cur = moveList; cur != end; ++cur)
+        if (pos.legal(*cur) && !pos.virtual_drop(*cur))
+            return true;
+    return false;
+}
+
+// 'promotable' tells whether a normal move could also be made as a promotion
+inline const std::string move_to_san(Position& pos, Move m, Notation n, Disambiguation d, bool promotable) {
     std::string san = "";
     Color us = pos.side_to_move();
     Square from = from_sq(m);
@@ -306,7 +341,6 @@ inline const std::string move_to_san(Position& pos, Move m, Notation n) {
             san += " ";
 
         // Origin square, disambiguation
-        Disambiguation d = disambiguation_level(pos, m, n);
         san += disambiguation(pos, from, n, d);
 
         // Separator/Operator
@@ -339,7 +373,7 @@ inline const std::string move_to_san(Position& pos, Move m, Notation n) {
             san += is_shogi(n) ? std::string("+") : std::string("=") + (char)toupper(pos.piece_to_char()[make_piece(us, pos.promoted_piece_type(type_of(pos.moved_piece(m))))]);
         else if (type_of(m) == PIECE_DEMOTION)
             san += is_shogi(n) ? std::string("-") : std::string("=") + std::string(1, toupper(pos.piece_to_char()[pos.unpromoted_piece_on(from)]));
-        else if (type_of(m) == NORMAL && is_shogi(n) && pos.pseudo_legal(make<PIECE_PROMOTION>(from, to)))
+        else if (promotable)
             san += std::string("=");
         if (is_gating(m))
             san += std::string("/") + (char)toupper(pos.piece_to_char()[make_piece(us, gating_type(m))]);
@@ -350,13 +384,103 @@ inline const std::string move_to_san(Position& pos, Move m, Notation n) {
     {
         StateInfo st;
         pos.do_move(m, st);
-        san += MoveList<LEGAL>(pos).size() ? "+" : "#";
+        san += has_legal_move(pos) ? "+" : "#";
         pos.undo_move(m);
     }
 
     return san;
 }
 
+inline const std::string move_to_san(Position& pos, Move m, Notation n) {
+    return move_to_san(pos, m, n, type_of(m) == CASTLING ? NO_DISAMBIGUATION : disambiguation_level(pos, m, n),
+                       type_of(m) == NORMAL && is_shogi(n) && pos.pseudo_legal(make<PIECE_PROMOTION>(from_sq(m), to_sq(m))));
+}
+
+// Converts all legal moves of a position at once. Since the legal moves are known,
+// the other pieces that can make the same move and the alternative promotions in
+// shogi are looked up in the legal moves grouped by everything but the origin square.
+inline std::vector<std::string> all_moves_to_san(Position& pos, const MoveList<LEGAL>& legalMoves, Notation n) {
+    auto without_origin = [](Move m) { return type_of(m) == DROP ? int(m) : int(m ^ make_move(from_sq(m), SQ_A1)); };
+    std::array<std::pair<int, Square>, MAX_MOVES> groups;
+    int size = 0;
+    for (const auto& m : legalMoves)
+        groups[size++] = {without_origin(m), from_sq(m)};
+    std::sort(groups.begin(), groups.begin() + size);
+
+    // Origin squares of the legal moves that only differ from m in their origin
+    auto origins = [&](Move m) {
+        Bitboard b = 0;
+        for (auto g = std::lower_bound(groups.begin(), groups.begin() + size, std::make_pair(without_origin(m), SQ_A1));
+             g != groups.begin() + size && g->first == without_origin(m); ++g)
+            b |= g->second;
+        return b;
+    };
+
+    std::vector<std::string> sanMoves;
+    sanMoves.reserve(size);
+    for (const auto& m : legalMoves)
+    {
+        Square from = from_sq(m);
+        Disambiguation d = type_of(m) == CASTLING ? NO_DISAMBIGUATION : disambiguation_level(pos, m, n, [&]() {
+            Bitboard b = origins(m) & pos.pieces(pos.side_to_move(), type_of(pos.moved_piece(m))) & ~square_bb(from);
+            Bitboard others = 0;
+            while (b)
+            {
+                Square s = pop_lsb(b);
+                if (!(is_shogi(n) && pos.unpromoted_piece_on(s) != pos.unpromoted_piece_on(from)))
+                    others |= s;
+            }
+            return others;
+        });
+        bool promotable = type_of(m) == NORMAL && is_shogi(n) && (origins(make<PIECE_PROMOTION>(from, to_sq(m))) & from);
+        sanMoves.push_back(move_to_san(pos, m, n, d, promotable));
+    }
+    return sanMoves;
+}
+
+// Converts a move string in the given notation to the corresponding legal move, if any.
+// Only the moves by the named piece to a destination square contained in the string
+// are candidates, so at most a few legal moves need to be converted for comparison.
+inline Move san_to_move(Position& pos, const std::string& san, Notation n) {
+    bool castling = san.compare(0, 3, "O-O") == 0;
+    // Whether the destination square occurs in the string, -1 if not known yet.
+    // The destination in WXF notation is relative, so only the piece can be used.
+    int8_t destination[SQUARE_NB];
+    std::fill(std::begin(destination), std::end(destination), int8_t(n == NOTATION_XIANGQI_WXF ? 1 : -1));
+
+    if (pos.is_immediate_game_end())
+        return MOVE_NONE;
+
+    // Legality is only verified for the candidates
+    ExtMove moveList[MAX_MOVES];
+    ExtMove* end = pos.checkers() ? generate<EVASIONS>(pos, moveList) : generate<NON_EVASIONS>(pos, moveList);
+
+    for (ExtMove* cur = moveList; cur != end; ++cur)
+    {
+        Move m = *cur;
+        if (type_of(m) == CASTLING)
+        {
+            if (!castling)
+                continue;
+        }
+        else
+        {
+            Square to = to_sq(m);
+            if (destination[to] < 0)
+                destination[to] = san.find(square(pos, to, n)) != std::string::npos;
+            if (!destination[to])
+                continue;
+            std::string pc = piece(pos, m, n);
+            if (san.compare(0, pc.size(), pc))
+                continue;
+        }
+        if (pos.legal(m) && !pos.virtual_drop(m) && move_to_san(pos, m, n) == san)
+            return m;
+    }
+
+    return MOVE_NONE;
+}
+
 } // namespace SAN
 
 inline bool has_insufficient_material(Color c, const Position& pos) {
@@ -405,662 +529,435 @@ inline bool is_check(const Position& pos) {
         || (pos.extinction_pseudo_royal() && pos.attackers_to_pseudo_royals(~pos.side_to_move()));
 }
 
-namespace FEN {
-
-enum FenValidation : int {
-    FEN_INVALID_COUNTING_RULE = -14,
-    FEN_INVALID_CHECK_COUNT = -13,
-    FEN_INVALID_NB_PARTS = -11,
-    FEN_INVALID_CHAR = -10,
-    FEN_TOUCHING_KINGS = -9,
-    FEN_INVALID_BOARD_GEOMETRY = -8,
-    FEN_INVALID_POCKET_INFO = -7,
-    FEN_INVALID_SIDE_TO_MOVE = -6,
-    FEN_INVALID_CASTLING_INFO = -5,
-    FEN_INVALID_EN_PASSANT_SQ = -4,
-    FEN_INVALID_NUMBER_OF_KINGS = -3,
-    FEN_INVALID_HALF_MOVE_COUNTER = -2,
-    FEN_INVALID_MOVE_COUNTER = -1,
-    FEN_EMPTY = 0,
-    FEN_OK = 1
-};
-enum Validation : int {
-    NOK,
-    OK
+// Per ply data of a replayed game: the SAN of each move and the FEN,
+// check status and immediate game end of the position it leads to.
+struct GameReplay {
+    std::vector<Move> moves;
+    std::vector<std::string> fens;
+    std::vector<std::string> sans;
+    std::vector<uint8_t> checks;
+    std::vector<uint8_t> gameEnds;
+    std::vector<int> results; // game result for the side to move if the game ended, else 0
 };
 
-struct CharSquare {
-    int rowIdx;
-    int fileIdx;
-    CharSquare() : rowIdx(-1), fileIdx(-1) {}
-    CharSquare(int row, int file) : rowIdx(row), fileIdx(file) {}
-};
-
-inline bool operator==(const CharSquare& s1, const CharSquare& s2) {
-    return s1.rowIdx == s2.rowIdx && s1.fileIdx == s2.fileIdx;
-}
-
-inline bool operator!=(const CharSquare& s1, const CharSquare& s2) {
-    return !(s1 == s2);
+// Replays a list of UCI moves in a single pass over the game. Returns the number
+// of moves replayed, which is less than the number of moves if one is invalid.
+inline size_t replay_game(Position& pos, StateListPtr& states, const std::vector<std::string>& moves, Notation n, GameReplay& replay) {
+    size_t plies = 0;
+    for (std::string move : moves)
+    {
+        Move m = UCI::to_move(pos, move);
+        if (m == MOVE_NONE)
+            break;
+        replay.moves.push_back(m);
+        replay.sans.push_back(SAN::move_to_san(pos, m, n));
+        states->emplace_back();
+        pos.do_move(m, states->back());
+
+        Value result = VALUE_ZERO;
+        bool gameEnd = pos.is_immediate_game_end(result);
+        replay.fens.push_back(pos.fen());
+        replay.checks.push_back(is_check(pos));
+        replay.gameEnds.push_back(gameEnd);
+        replay.results.push_back(gameEnd ? result : VALUE_ZERO);
+        ++plies;
+    }
+    return plies;
+}
+
+// Piece types of the planes of a position: the piece types of the variant
+// and the piece types they are promoted to.
+inline std::vector<PieceType> plane_piece_types(const Variant* v) {
+    std::set<PieceType> types(v->pieceTypes);
+    for (PieceType pt : v->pieceTypes)
+        if (v->promotedPieceType[pt])
+            types.insert(v->promotedPieceType[pt]);
+    return std::vector<PieceType>(types.begin(), types.end());
+}
+
+// Labels of the piece planes, white pieces first, using "+" and the
+// unpromoted piece for promoted pieces without a character of their own.
+inline std::vector<std::string> plane_pieces(const Variant* v) {
+    std::vector<std::string> pieces;
+    for (Color c : {WHITE, BLACK})
+        for (PieceType pt : plane_piece_types(v))
+        {
+            std::string label(1, v->pieceToChar[make_piece(c, pt)]);
+            if (label == " ")
+                for (PieceType base : v->pieceTypes)
+                    if (v->promotedPieceType[base] == pt)
+                    {
+                        label = std::string("+") + v->pieceToChar[make_piece(c, base)];
+                        break;
+                    }
+            pieces.push_back(label);
+        }
+    return pieces;
 }
 
-inline int non_root_euclidian_distance(const CharSquare& s1, const CharSquare& s2) {
-    return pow(s1.rowIdx - s2.rowIdx, 2) + pow(s1.fileIdx - s2.fileIdx, 2);
+// Piece planes, followed by the same number of pocket planes in drop variants
+inline size_t plane_count(const Variant* v) {
+    return 2 * plane_piece_types(v).size() * (v->pieceDrops ? 2 : 1);
 }
 
-class CharBoard {
-private:
-    int nbRanks;
-    int nbFiles;
-    std::vector<char> board;  // fill an array where the pieces are for later geometry checks
-public:
-    CharBoard(int ranks, int files) : nbRanks(ranks), nbFiles(files) {
-        assert(nbFiles > 0 && nbRanks > 0);
-        board = std::vector<char>(nbRanks * nbFiles, ' ');
-    }
-    void set_piece(int rankIdx, int fileIdx, char c) {
-        board[rankIdx * nbFiles + fileIdx] = c;
-    }
-    char get_piece(int rowIdx, int fileIdx) const {
-        return board[rowIdx * nbFiles + fileIdx];
-    }
-    int get_nb_ranks() const {
-        return nbRanks;
-    }
-    int get_nb_files() const {
-        return nbFiles;
-    }
-    /// Returns the square of a given character
-    CharSquare get_square_for_piece(char piece) const {
-        CharSquare s;
-        for (int r = 0; r < nbRanks; ++r)
+// Writes the position as plane_count() dense planes of ranks x files, indexed by
+// rank * files + file. Each piece plane marks the squares of the pieces of one
+// color and piece type in the order of plane_pieces(). Each pocket plane is filled
+// with the number of pieces in hand of the corresponding piece plane.
+inline void board_planes(const Position& pos, int8_t* planes) {
+    const Variant* v = pos.variant();
+    const std::vector<PieceType> types = plane_piece_types(v);
+    const int files = v->maxFile + 1, size = files * (v->maxRank + 1), n = types.size();
+    std::fill(planes, planes + plane_count(v) * size, int8_t(0));
+    for (Color c : {WHITE, BLACK})
+        for (int i = 0; i < n; ++i)
         {
-            for (int c = 0; c < nbFiles; ++c)
+            int8_t* plane = planes + (c * n + i) * size;
+            Bitboard b = pos.pieces(c, types[i]);
+            while (b)
             {
-                if (get_piece(r, c) == piece)
-                {
-                    s.rowIdx = r;
-                    s.fileIdx = c;
-                    return s;
-                }
+                Square s = pop_lsb(b);
+                plane[rank_of(s) * files + file_of(s)] = 1;
             }
+            if (v->pieceDrops)
+                std::fill(plane + 2 * n * size, plane + 2 * n * size + size,
+                          int8_t(std::clamp(pos.count_in_hand(c, types[i]), -128, 127)));
         }
-        return s;
-    }
-    /// Returns all square positions for a given piece
-    std::vector<CharSquare> get_squares_for_piece(char piece) const {
-        std::vector<CharSquare> squares;
-        for (int r = 0; r < nbRanks; ++r)
-            for (int c = 0; c < nbFiles; ++c)
-                if (get_piece(r, c) == piece)
-                    squares.emplace_back(CharSquare(r, c));
-        return squares;
-    }
-    friend std::ostream& operator<<(std::ostream& os, const CharBoard& board);
+}
+
+// Names of the move types of decode_move(), in the order of MoveType
+constexpr const char* MoveTypeNames[] = {
+    "normal", "enpassant", "castling", "promotion", "drop", "piece_promotion", "piece_demotion", "special"
 };
 
-inline std::ostream& operator<<(std::ostream& os, const CharBoard& board) {
-    for (int r = 0; r < board.nbRanks; ++r)
-    {
-        for (int c = 0; c < board.nbFiles; ++c)
-            os << "[" << board.get_piece(r, c) << "] ";
-        os << std::endl;
-    }
-    return os;
-}
+// A move of the packed move arrays, independent of the build
+struct DecodedMove {
+    int from;          // rank * files + file like the planes, -1 for drops
+    int to;
+    const char* type;  // one of MoveTypeNames
+    int piece;         // index of the promoted, dropped or gated piece type in plane_piece_types(), or -1
+};
 
-inline bool contains(const std::string& str, char c) {
-    return str.find(c) != std::string::npos;
+// The packed move arrays hold engine moves, whose bits depend on the build, e.g. on
+// largeboards. decode_move() reads them for the variant of the position they belong to.
+inline DecodedMove decode_move(const Variant* v, Move m) {
+    const int files = v->maxFile + 1;
+    const size_t typeIdx = type_of(m) >> (2 * SQUARE_BITS);
+    PieceType pt =  type_of(m) == PROMOTION ? promotion_type(m)
+                  : type_of(m) == DROP      ? dropped_piece_type(m)
+                  : is_gating(m)            ? gating_type(m)
+                                            : NO_PIECE_TYPE;
+    const std::vector<PieceType> types = plane_piece_types(v);
+    auto it = std::find(types.begin(), types.end(), pt);
+    Square to = to_sq(m), from = from_sq(m);
+    return DecodedMove{
+        type_of(m) == DROP ? -1 : int(rank_of(from)) * files + file_of(from),
+        int(rank_of(to)) * files + file_of(to),
+        typeIdx < std::size(MoveTypeNames) ? MoveTypeNames[typeIdx] : "invalid",
+        pt != NO_PIECE_TYPE && it != types.end() ? int(it - types.begin()) : -1
+    };
 }
 
-inline bool in_any(const std::vector<std::string>& vec, char c) {
-    for (std::string str : vec)
-        if (contains(str, c))
-            return true;
-    return false;
-}
+namespace FEN {
 
-inline Validation check_for_valid_characters(const std::string& firstFenPart, const std::string& validSpecialCharactersFirstField, const Variant* v) {
-    for (char c : firstFenPart)
-    {
-        if (!isdigit(c) && !in_any({v->pieceToChar, v->pieceToCharSynonyms, validSpecialCharactersFirstField}, c))
-        {
-            std::cerr << "Invalid piece character: '" << c << "'." << std::endl;
-            return NOK;
-        }
-    }
-    return OK;
+/// diagnose_fen() checks a FEN and reports the reason of a failed check on std::cerr.
+inline FenValidation diagnose_fen(const FenValidator& validator, std::string_view fen) {
+    FenValidation result = validator.validate(fen);
+    if (result != FEN_OK)
+        std::cerr << fen_validation_reason(result) << " FEN: '" << fen << "'" << std::endl;
+    return result;
 }
 
-inline std::vector<std::string> get_fen_parts(const std::string& fullFen, char delim) {
-    std::vector<std::string> fenParts;
-    std::string curPart;
-    std::stringstream ss(fullFen);
-    while (std::getline(ss, curPart, delim))
-        fenParts.emplace_back(curPart);
-    return fenParts;
+/// validate_fen() checks a single FEN like check_fen() and reports the reason
+/// of a failed check on std::cerr.
+inline FenValidation validate_fen(const std::string& fen, const Variant* v, bool chess960 = false) {
+    FenValidation result = check_fen(fen, v, chess960);
+    if (result != FEN_OK)
+        std::cerr << fen_validation_reason(result) << " FEN: '" << fen << "'" << std::endl;
+    return result;
 }
+} // namespace FEN
 
-/// fills the character board according to a given FEN string
-inline Validation fill_char_board(CharBoard& board, const std::string& fenBoard, const std::string& validSpecialCharactersFirstField, const Variant* v) {
-    int rankIdx = 0;
-    int fileIdx = 0;
-
-    char prevChar = '?';
-    for (char c : fenBoard)
-    {
-        if (c == ' ' || c == '[')
-            break;
-        if (isdigit(c))
-        {
-            fileIdx += c - '0';
-            // if we have multiple digits attached we can add multiples of 9 to compute the resulting number (e.g. -> 21 = 2 + 2 * 9 + 1)
-            if (isdigit(prevChar))
-                fileIdx += 9 * (prevChar - '0');
-        }
-        else if (c == '/')
-        {
-            ++rankIdx;
-            if (fileIdx != board.get_nb_files())
-            {
-                std::cerr << "curRankWidth != nbFiles: " << fileIdx << " != " << board.get_nb_files() << std::endl;
-                return NOK;
-            }
-            if (rankIdx == board.get_nb_ranks())
-                break;
-            fileIdx = 0;
-        }
-        else if (!contains(validSpecialCharactersFirstField, c))
-        {  // normal piece
-            if (fileIdx == board.get_nb_files())
-            {
-                std::cerr << "File index: " << fileIdx << " for piece '" << c << "' exceeds maximum of allowed number of files: " << board.get_nb_files() << "." << std::endl;
-                return NOK;
-            }
-            board.set_piece(v->maxRank-rankIdx, fileIdx, c);  // we mirror the rank index because the black pieces are given first in the FEN
-            ++fileIdx;
-        }
-        prevChar = c;
+namespace PGN {
+
+// A game read from a PGN stream, with its tag pairs in order of appearance,
+// the start position and the mainline moves in UCI notation. Readers that keep
+// their positions also hand over the final position of the replay, its states
+// and the moves leading to it.
+struct Game {
+    std::vector<std::pair<std::string, std::string>> headers;
+    std::string variant = "chess";
+    std::string fen;
+    bool chess960 = false;
+    std::vector<std::string> moves;
+    std::string result;
+    std::string error;  // first problem while replaying the moves, if any
+    std::unique_ptr<Position> position;
+    StateListPtr states;
+    std::vector<Move> line;
+
+    std::string header(const std::string& key) const {
+        for (const auto& [k, value] : headers)
+            if (k == key)
+                return value;
+        return "";
     }
+};
 
-    if (v->pieceDrops)
-    { // pockets can either be defined by [] or /
-        if (rankIdx+1 != board.get_nb_ranks() && rankIdx != board.get_nb_ranks())
-        {
-            std::cerr << "Invalid number of ranks. Expected: " << board.get_nb_ranks() << " Actual: " << rankIdx+1 << std::endl;
-            return NOK;
-        }
-    }
-    else
-    {
-        if (rankIdx+1 != board.get_nb_ranks())
-        {
-            std::cerr << "Invalid number of ranks. Expected: " << board.get_nb_ranks() << " Actual: " << rankIdx+1 << std::endl;
-            return NOK;
-        }
-    }
-    return OK;
-}
+// Reader is a streaming PGN parser. Text can be fed in chunks of any size,
+// completed games are queued until taken with next(). Comments, recursive
+// variations, NAGs, move numbers and annotation glyphs are skipped, the
+// mainline moves are replayed on a single reused position, unless the positions
+// are kept, in which case every game is replayed on its own.
+class Reader {
+public:
+    explicit Reader(Thread* th, Notation n = NOTATION_SAN, bool keep = false)
+        : thread(th), notation(n), keepPositions(keep) {}
 
-inline Validation check_touching_kings(const CharBoard& board, const std::array<CharSquare, 2>& kingPositions) {
-    if (non_root_euclidian_distance(kingPositions[WHITE], kingPositions[BLACK]) <= 2)
-    {
-        std::cerr << "King pieces are next to each other." << std::endl;
-        std::cerr << board << std::endl;
-        return NOK;
+    void feed(const char* data, size_t size) {
+        for (size_t i = 0; i < size; ++i)
+            put(data[i]);
     }
-    return OK;
-}
 
-inline Validation fill_castling_info_splitted(const std::string& castlingInfo, std::array<std::string, 2>& castlingInfoSplitted) {
-    for (char c : castlingInfo)
-    {
-        if (c != '-')
-        {
-            if (!isalpha(c))
-            {
-                std::cerr << "Invalid castling specification: '" << c << "'." << std::endl;
-                return NOK;
-            }
-            else if (isupper(c))
-                castlingInfoSplitted[WHITE] += tolower(c);
-            else
-                castlingInfoSplitted[BLACK] += c;
-        }
+    // Signals the end of the input, which also ends a game without termination marker
+    void finish() {
+        put('\n');
+        if (inGame)
+            end_game("");
     }
-    return OK;
-}
 
-inline std::string color_to_string(Color c) {
-    switch (c)
-    {
-    case WHITE:
-        return "WHITE";
-    case BLACK:
-        return "BLACK";
-    case COLOR_NB:
-        return "COLOR_NB";
-    default:
-        return "INVALID_COLOR";
-    }
-}
+    bool has_next() const { return !games.empty(); }
 
-inline std::string castling_rights_to_string(CastlingRights castlingRights) {
-    switch (castlingRights)
-    {
-    case KING_SIDE:
-        return "KING_SIDE";
-    case QUEEN_SIDE:
-        return "QUEENS_SIDE";
-    case WHITE_OO:
-        return "WHITE_OO";
-    case WHITE_OOO:
-        return "WHITE_OOO";
-    case BLACK_OO:
-        return "BLACK_OO";
-    case BLACK_OOO:
-        return "BLACK_OOO";
-    case WHITE_CASTLING:
-        return "WHITE_CASTLING";
-    case BLACK_CASTLING:
-        return "BLACK_CASTLING";
-    case ANY_CASTLING:
-        return "ANY_CASTLING";
-    case CASTLING_RIGHT_NB:
-        return "CASTLING_RIGHT_NB";
-    default:
-        return "INVALID_CASTLING_RIGHTS";
+    bool next(Game& game) {
+        if (games.empty())
+            return false;
+        game = std::move(games.front());
+        games.pop_front();
+        return true;
     }
-}
 
-inline Validation check_castling_rank(const std::array<std::string, 2>& castlingInfoSplitted, const CharBoard& board,
-                            const std::array<CharSquare, 2>& kingPositions, const Variant* v) {
+private:
+    enum State { MOVETEXT, TAG_KEY, TAG_SPACE, TAG_VALUE, TAG_ESCAPE, TAG_END, COMMENT, LINE_COMMENT };
 
-    for (Color c : {WHITE, BLACK})
-    {
-        const Rank castlingRank = relative_rank(c, v->castlingRank, v->maxRank);
-        char rookChar = v->pieceToChar[make_piece(c, v->castlingRookPiece)];
-        for (char castlingFlag : castlingInfoSplitted[c])
+    void put(char c) {
+        bool lineStart = previous == '\n';
+        previous = c;
+
+        switch (state)
         {
-            if (tolower(castlingFlag) == 'k' || tolower(castlingFlag) == 'q')
+        case MOVETEXT:
+            if (lineStart && c == '%')
+                state = LINE_COMMENT;
+            else if (c == '[' && token.empty() && !ravDepth)
             {
-                if (kingPositions[c].rowIdx != castlingRank)
-                {
-                    std::cerr << "The " << color_to_string(c) << " king must be on rank " << castlingRank << " if castling is enabled for " << color_to_string(c) << "." << std::endl;
-                    return NOK;
-                }
-                bool kingside = tolower(castlingFlag) == 'k';
-                bool castlingRook = false;
-                for (int f = kingside ? board.get_nb_files() - 1 : 0; f != kingPositions[c].fileIdx; kingside ? f-- : f++)
-                    if (board.get_piece(castlingRank, f) == rookChar)
-                    {
-                        castlingRook = true;
-                        break;
-                    }
-                if (!castlingRook)
-                {
-                    std::cerr << "No castling rook for flag " << castlingFlag << std::endl;
-                    return NOK;
-                }
+                // Tag pairs after movetext belong to the next game
+                if (inGame && (replaying || !current.error.empty()))
+                    end_game("");
+                inGame = true;
+                key.clear();
+                value.clear();
+                state = TAG_KEY;
             }
-            else if (board.get_piece(castlingRank, tolower(castlingFlag) - 'a') == ' ')
+            else if (c == '{' || c == ';' || c == '(' || c == ')' || std::isspace(static_cast<unsigned char>(c)))
             {
-                std::cerr << "No gating piece for flag " << castlingFlag << std::endl;
-                return NOK;
+                end_token();
+                if (c == '{')
+                    state = COMMENT;
+                else if (c == ';')
+                    state = LINE_COMMENT;
+                else if (c == '(')
+                    ++ravDepth;
+                else if (c == ')' && ravDepth)
+                    --ravDepth;
             }
+            else
+                token += c;
+            break;
+        case TAG_KEY:
+            if (std::isspace(static_cast<unsigned char>(c)))
+                state = TAG_SPACE;
+            else if (c == '"')
+                state = TAG_VALUE;
+            else if (c == ']')
+                end_tag();
+            else
+                key += c;
+            break;
+        case TAG_SPACE:
+            if (c == '"')
+                state = TAG_VALUE;
+            else if (c == ']')
+                end_tag();
+            break;
+        case TAG_VALUE:
+            if (c == '\\')
+                state = TAG_ESCAPE;
+            else if (c == '"')
+                state = TAG_END;
+            else
+                value += c;
+            break;
+        case TAG_ESCAPE:
+            value += c;
+            state = TAG_VALUE;
+            break;
+        case TAG_END:
+            if (c == ']')
+                end_tag();
+            break;
+        case COMMENT:
+            if (c == '}')
+                state = MOVETEXT;
+            break;
+        case LINE_COMMENT:
+            if (c == '\n')
+                state = MOVETEXT;
+            break;
         }
     }
-    return OK;
-}
 
-inline Validation check_standard_castling(std::array<std::string, 2>& castlingInfoSplitted, const CharBoard& board,
-                             const std::array<CharSquare, 2>& kingPositions, const std::array<CharSquare, 2>& kingPositionsStart,
-                             const std::array<std::vector<CharSquare>, 2>& rookPositionsStart, const Variant* v) {
-
-    for (Color c : {WHITE, BLACK})
-    {
-        if (castlingInfoSplitted[c].size() == 0)
-            continue;
-        if (kingPositions[c] != kingPositionsStart[c])
-        {
-            std::cerr << "The " << color_to_string(c) << " KING has moved. Castling is no longer valid for " << color_to_string(c) << "." << std::endl;
-            return NOK;
-        }
-
-        for (CastlingRights castling: {KING_SIDE, QUEEN_SIDE})
-        {
-            CharSquare rookStartingSquare = castling == QUEEN_SIDE ? rookPositionsStart[c][0] : rookPositionsStart[c][1];
-            char targetChar = castling == QUEEN_SIDE ? 'q' : 'k';
-            char rookChar = v->pieceToChar[make_piece(c, v->castlingRookPiece)];
-            if (castlingInfoSplitted[c].find(targetChar) != std::string::npos)
-            {
-                if (board.get_piece(rookStartingSquare.rowIdx, rookStartingSquare.fileIdx) != rookChar)
-                {
-                    std::cerr << "The " << color_to_string(c) << " ROOK on the "<<  castling_rights_to_string(castling) << " has moved. "
-                              << castling_rights_to_string(castling) << " castling is no longer valid for " << color_to_string(c) << "." << std::endl;
-                    return NOK;
-                }
-            }
-
-        }
+    void end_tag() {
+        current.headers.emplace_back(key, value);
+        state = MOVETEXT;
     }
-    return OK;
-}
 
-inline Validation check_pocket_info(const std::string& fenBoard, int nbRanks, const Variant* v, std::string& pocket) {
-
-    char stopChar;
-    int offset = 0;
-    if (std::count(fenBoard.begin(), fenBoard.end(), '/') == nbRanks)
-    {
-        // look for last '/'
-        stopChar = '/';
-    }
-    else if (std::count(fenBoard.begin(), fenBoard.end(), '[') == 1)
-    {
-        // pocket is defined as [ and ]
-        stopChar = '[';
-        offset = 1;
-        if (*(fenBoard.end()-1) != ']')
+    void end_token() {
+        if (token.empty())
+            return;
+        std::string t;
+        std::swap(t, token);
+        // Skip variations and NAGs
+        if (ravDepth || t[0] == '$')
+            return;
+        if (t == "1-0" || t == "0-1" || t == "1/2-1/2" || t == "*")
         {
-            std::cerr << "Pocket specification does not end with ']'." << std::endl;
-            return NOK;
+            end_game(t);
+            return;
         }
-    }
-    else
-        // allow to skip pocket
-        return OK;
-
-    // look for last '/'
-    for (auto it = fenBoard.rbegin()+offset; it != fenBoard.rend(); ++it)
-    {
-        const char c = *it;
-        if (c == stopChar)
-            return OK;
-        if (c != '-')
+        // Strip move numbers and annotation glyphs
+        size_t start = 0;
+        while (start < t.size() && std::isdigit(static_cast<unsigned char>(t[start])))
+            ++start;
+        if (start < t.size() && t[start] == '.')
+            t.erase(0, t.find_first_not_of('.', start));
+        t.erase(t.find_last_not_of("!?") + 1);
+        if (!t.empty() && t != "...")
         {
-            if (!in_any({v->pieceToChar, v->pieceToCharSynonyms}, c))
-            {
-                std::cerr << "Invalid pocket piece: '" << c << "'." << std::endl;
-                return NOK;
-            }
-            else
-                pocket += c;
+            inGame = true;
+            replay(t);
         }
     }
-    std::cerr << "Pocket piece closing character '" << stopChar << "' was not found." << std::endl;
-    return NOK;
-}
-
-inline int piece_count(const std::string& fenBoard, Color c, PieceType pt, const Variant* v) {
-    return std::count(fenBoard.begin(), fenBoard.end(), v->pieceToChar[make_piece(c, pt)]);
-}
-
-inline Validation check_number_of_kings(const std::string& fenBoard, const std::string& startFenBoard, const Variant* v) {
-    int nbWhiteKings = piece_count(fenBoard, WHITE, KING, v);
-    int nbBlackKings = piece_count(fenBoard, BLACK, KING, v);
-    int nbWhiteKingsStart = piece_count(startFenBoard, WHITE, KING, v);
-    int nbBlackKingsStart = piece_count(startFenBoard, BLACK, KING, v);
-
-    if (nbWhiteKings != nbWhiteKingsStart)
-    {
-        std::cerr << "Invalid number of white kings. Expected: " << nbWhiteKingsStart << ". Given: " << nbWhiteKings << std::endl;
-        return NOK;
-    }
-    if (nbBlackKings != nbBlackKingsStart)
-    {
-        std::cerr << "Invalid number of black kings. Expected: " << nbBlackKingsStart << ". Given: " << nbBlackKings << std::endl;
-        return NOK;
-    }
-    return OK;
-}
-
 
-inline Validation check_en_passant_square(const std::string& enPassantInfo) {
-    if (enPassantInfo.size() != 1 || enPassantInfo[0] != '-')
-    {
-        if (enPassantInfo.size() != 2)
+    bool setup() {
+        replaying = true;
+        std::string variant = current.header("Variant");
+        std::transform(variant.begin(), variant.end(), variant.begin(), [](unsigned char c){ return std::tolower(c); });
+        if (variant.size() >= 3 && variant.compare(variant.size() - 3, 3, "960") == 0)
         {
-            std::cerr << "Invalid en-passant square '" << enPassantInfo << "'. Expects 2 characters. Actual: " << enPassantInfo.size() << " character(s)." << std::endl;
-            return NOK;
+            current.chess960 = true;
+            variant.erase(variant.size() - 3);
         }
-        if (!isalpha(enPassantInfo[0]))
+        // Variant names used by lichess
+        if (variant == "three-check")
+            variant = "3check";
+        else if (variant == "king of the hill")
+            variant = "kingofthehill";
+        else if (variant == "racing kings")
+            variant = "racingkings";
+        if (!variant.empty() && variant != "standard" && variant != "from position")
+            current.variant = variant;
+
+        auto it = variants.find(current.variant);
+        if (it == variants.end())
         {
-            std::cerr << "Invalid en-passant square '" << enPassantInfo << "'. Expects 1st character to be a letter." << std::endl;
-            return NOK;
+            current.error = "Unknown variant '" + current.variant + "'";
+            return false;
         }
-        if (!isdigit(enPassantInfo[1]))
+        const Variant* v = it->second;
+        current.fen = current.header("FEN");
+        if (current.fen.empty())
+            current.fen = v->startFen;
+        else if (FEN::validate_fen(current.fen, v, current.chess960) != FEN::FEN_OK)
         {
-            std::cerr << "Invalid en-passant square '" << enPassantInfo << "'. Expects 2nd character to be a digit." << std::endl;
-            return NOK;
-        }
-    }
-    return OK;
-}
-
-
-inline Validation check_check_count(const std::string& checkCountInfo) {
-    if (checkCountInfo.size() != 3)
-    {
-        std::cerr << "Invalid check count '" << checkCountInfo << "'. Expects 3 characters. Actual: " << checkCountInfo.size() << " character(s)." << std::endl;
-        return NOK;
-    }
-    if (!isdigit(checkCountInfo[0]))
-    {
-        std::cerr << "Invalid check count '" << checkCountInfo << "'. Expects 1st character to be a digit." << std::endl;
-        return NOK;
-    }
-    if (!isdigit(checkCountInfo[2])) {
-        std::cerr << "Invalid check count '" << checkCountInfo << "'. Expects 3rd character to be a digit." << std::endl;
-        return NOK;
-    }
-    return OK;
-}
-
-inline Validation check_lichess_check_count(const std::string& checkCountInfo) {
-    if (checkCountInfo.size() != 4)
-    {
-        std::cerr << "Invalid check count '" << checkCountInfo << "'. Expects 4 characters. Actual: " << checkCountInfo.size() << " character(s)." << std::endl;
-        return NOK;
-    }
-    if (!isdigit(checkCountInfo[1]) || checkCountInfo[1] - '0' > 3)
-    {
-        std::cerr << "Invalid check count '" << checkCountInfo << "'. Expects 2nd character to be a digit up to 3." << std::endl;
-        return NOK;
-    }
-    if (!isdigit(checkCountInfo[3]) || checkCountInfo[3] - '0' > 3) {
-        std::cerr << "Invalid check count '" << checkCountInfo << "'. Expects 4th character to be a digit up to 3." << std::endl;
-        return NOK;
-    }
-    return OK;
-}
-
-inline Validation check_digit_field(const std::string& field) {
-    if (field.size() == 1 && field[0] == '-')
-        return OK;
-    for (char c : field)
-        if (!isdigit(c))
-            return NOK;
-    return OK;
-}
-
-inline std::string get_valid_special_chars(const Variant* v) {
-    std::string validSpecialCharactersFirstField = "/";
-    // Whether or not '-', '+', '~', '[', ']' are valid depends on the variant being played.
-    if (v->shogiStylePromotions)
-        validSpecialCharactersFirstField += '+';
-    if (!v->promotionPieceTypes.empty())
-        validSpecialCharactersFirstField += '~';
-    if (!v->freeDrops && (v->pieceDrops || v->seirawanGating || v->arrowGating))
-        validSpecialCharactersFirstField += "[-]";
-    return validSpecialCharactersFirstField;
-}
-
-inline FenValidation validate_fen(const std::string& fen, const Variant* v, bool chess960 = false) {
-
-    const std::string validSpecialCharactersFirstField = get_valid_special_chars(v);
-    // 0) Layout
-    // check for empty fen
-    if (fen.empty())
-    {
-        std::cerr << "Fen is empty." << std::endl;
-        return FEN_EMPTY;
-    }
-
-    std::vector<std::string> fenParts = get_fen_parts(fen, ' ');
-    std::vector<std::string> startFenParts = get_fen_parts(v->startFen, ' ');
-
-    // check for number of parts
-    const unsigned int maxNumberFenParts = 6 + v->checkCounting;
-    if (fenParts.size() < 1 || fenParts.size() > maxNumberFenParts)
-    {
-        std::cerr << "Invalid number of fen parts. Expected: >= 1 and <= " << maxNumberFenParts
-                  << " Actual: " << fenParts.size() << std::endl;
-        return FEN_INVALID_NB_PARTS;
-    }
-
-    // 1) Part
-    // check for valid characters
-    if (check_for_valid_characters(fenParts[0], validSpecialCharactersFirstField, v) == NOK)
-        return FEN_INVALID_CHAR;
-
-    // check for number of ranks
-    const int nbRanks = v->maxRank + 1;
-    // check for number of files
-    const int nbFiles = v->maxFile + 1;
-    CharBoard board(nbRanks, nbFiles);  // create a 2D character board for later geometry checks
-
-    if (fill_char_board(board, fenParts[0], validSpecialCharactersFirstField, v) == NOK)
-        return FEN_INVALID_BOARD_GEOMETRY;
-
-    // check for pocket
-    std::string pocket = "";
-    if (v->pieceDrops || v->seirawanGating || v->arrowGating)
-    {
-        if (check_pocket_info(fenParts[0], nbRanks, v, pocket) == NOK)
-            return FEN_INVALID_POCKET_INFO;
-    }
-
-    // check for number of kings
-    if (v->pieceTypes.find(KING) != v->pieceTypes.end())
-    {
-        // we have a royal king in this variant,
-        // ensure that each side has exactly as many kings as in the starting position
-        // (variants like giveaway use the COMMONER piece type instead)
-        if (check_number_of_kings(fenParts[0], startFenParts[0], v) == NOK)
-            return FEN_INVALID_NUMBER_OF_KINGS;
-
-        // check for touching kings if there are exactly two royal kings on the board (excluding pocket)
-        if (   v->kingType == KING
-            && piece_count(fenParts[0], WHITE, KING, v) - piece_count(pocket, WHITE, KING, v) == 1
-            && piece_count(fenParts[0], BLACK, KING, v) - piece_count(pocket, BLACK, KING, v) == 1)
-        {
-            std::array<CharSquare, 2> kingPositions;
-            kingPositions[WHITE] = board.get_square_for_piece(v->pieceToChar[make_piece(WHITE, KING)]);
-            kingPositions[BLACK] = board.get_square_for_piece(v->pieceToChar[make_piece(BLACK, KING)]);
-            if (check_touching_kings(board, kingPositions) == NOK)
-                return FEN_TOUCHING_KINGS;
+            current.error = "Invalid FEN '" + current.fen + "'";
+            return false;
         }
-    }
-
-    // 2) Part
-    // check side to move char
-    if (fenParts.size() >= 2 && fenParts[1][0] != 'w' && fenParts[1][0] != 'b')
-    {
-        std::cerr << "Invalid side to move specification: '" << fenParts[1][0] << "'." << std::endl;
-        return FEN_INVALID_SIDE_TO_MOVE;
-    }
 
-    // Castling and en passant can be skipped
-    bool skipCastlingAndEp = fenParts.size() >= 4 && fenParts.size() <= 5 && isdigit(fenParts[2][0]);
-
-    // 3) Part
-    // check castling rights
-    if (fenParts.size() >= 3 && !skipCastlingAndEp && v->castling)
-    {
-        std::array<std::string, 2> castlingInfoSplitted;
-        if (fill_castling_info_splitted(fenParts[2], castlingInfoSplitted) == NOK)
-            return FEN_INVALID_CASTLING_INFO;
-
-        if (castlingInfoSplitted[WHITE].size() != 0 || castlingInfoSplitted[BLACK].size() != 0)
+        UCI::init_variant(v);
+        if (!pos || keepPositions)
+            pos = std::make_unique<Position>();
+        states = StateListPtr(new std::deque<StateInfo>(1));
+        pos->set(v, current.fen, current.chess960, &states->back(), thread);
+        return true;
+    }
+
+    void replay(const std::string& san) {
+        if (!current.error.empty() || (!replaying && !setup()))
+            return;
+
+        // Castling is often written with zeros
+        std::string move = san;
+        if (move.rfind("0-0", 0) == 0)
+            for (size_t i = 0; i < move.size() && (move[i] == '0' || move[i] == '-'); ++i)
+                if (move[i] == '0')
+                    move[i] = 'O';
+
+        Position& pos = *this->pos;
+        Move m = SAN::san_to_move(pos, move, notation);
+        // Tolerate missing or superfluous check and mate markers
+        if (!m && notation == NOTATION_SAN)
         {
-            std::array<CharSquare, 2> kingPositions;
-            kingPositions[WHITE] = board.get_square_for_piece(toupper(v->pieceToChar[v->castlingKingPiece]));
-            kingPositions[BLACK] = board.get_square_for_piece(tolower(v->pieceToChar[v->castlingKingPiece]));
-
-            CharBoard startBoard(board.get_nb_ranks(), board.get_nb_files());
-            fill_char_board(startBoard, v->startFen, validSpecialCharactersFirstField, v);
-
-            // Check pieces present on castling rank against castling/gating rights
-            if (check_castling_rank(castlingInfoSplitted, board, kingPositions, v) == NOK)
-                return FEN_INVALID_CASTLING_INFO;
-
-            // only check exact squares if starting position of castling pieces is known
-            if (!v->chess960 && !v->castlingDroppedPiece && !chess960)
-            {
-                std::array<CharSquare, 2> kingPositionsStart;
-                kingPositionsStart[WHITE] = startBoard.get_square_for_piece(v->pieceToChar[make_piece(WHITE, v->castlingKingPiece)]);
-                kingPositionsStart[BLACK] = startBoard.get_square_for_piece(v->pieceToChar[make_piece(BLACK, v->castlingKingPiece)]);
-                std::array<std::vector<CharSquare>, 2> rookPositionsStart;
-                rookPositionsStart[WHITE] = startBoard.get_squares_for_piece(v->pieceToChar[make_piece(WHITE, v->castlingRookPiece)]);
-                rookPositionsStart[BLACK] = startBoard.get_squares_for_piece(v->pieceToChar[make_piece(BLACK, v->castlingRookPiece)]);
-
-                if (check_standard_castling(castlingInfoSplitted, board, kingPositions, kingPositionsStart, rookPositionsStart, v) == NOK)
-                    return FEN_INVALID_CASTLING_INFO;
-            }
+            std::string plain = move.substr(0, move.find_last_not_of("+#") + 1);
+            for (const std::string& alternative : {plain, plain + "+", plain + "#"})
+                if (alternative != move && (m = SAN::san_to_move(pos, alternative, notation)))
+                    break;
         }
-    }
-
-    // 4) Part
-    // check en-passant square
-    if (fenParts.size() >= 4 && !skipCastlingAndEp)
-    {
-        if (v->doubleStep && v->pieceTypes.find(PAWN) != v->pieceTypes.end())
+        if (!m)
         {
-            if (check_en_passant_square(fenParts[3]) == NOK)
-                return FEN_INVALID_EN_PASSANT_SQ;
+            current.error = "Invalid move '" + san + "' in position '" + pos.fen() + "'";
+            return;
         }
-        else if (v->countingRule && !check_digit_field(fenParts[3]))
-            return FEN_INVALID_COUNTING_RULE;
-    }
-
-    // 5) Part
-    // check check count
-    unsigned int optionalInbetweenFields = 2 * !skipCastlingAndEp;
-    unsigned int optionalTrailingFields = 0;
-    if (fenParts.size() >= 3 + optionalInbetweenFields && v->checkCounting && fenParts.size() % 2)
-    {
-        if (check_check_count(fenParts[2 + optionalInbetweenFields]) == NOK)
+        current.moves.push_back(UCI::move(pos, m));
+        if (keepPositions)
+            current.line.push_back(m);
+        states->emplace_back();
+        pos.do_move(m, states->back());
+    }
+
+    void end_game(const std::string& result) {
+        // Games without moves still need their start position
+        if (!replaying && current.error.empty())
+            setup();
+        current.result = result.empty() ? current.header("Result") : result;
+        if (current.result.empty())
+            current.result = "*";
+        // The position is only set up if the variant and start position are valid
+        if (keepPositions && replaying && pos)
         {
-            // allow valid lichess style check as alternative
-            if (fenParts.size() < 5 + optionalInbetweenFields || check_lichess_check_count(fenParts[fenParts.size() - 1]) == NOK)
-                return FEN_INVALID_CHECK_COUNT;
-            else
-                optionalTrailingFields++;
+            current.position = std::move(pos);
+            current.states = std::move(states);
         }
-        else
-            optionalInbetweenFields++;
-    }
-
-    // 6) Part
-    // check half move counter
-    if (fenParts.size() >= 3 + optionalInbetweenFields && !check_digit_field(fenParts[fenParts.size() - 2 - optionalTrailingFields]))
-    {
-        std::cerr << "Invalid half move counter: '" << fenParts[fenParts.size()-2] << "'." << std::endl;
-        return FEN_INVALID_HALF_MOVE_COUNTER;
-    }
-
-    // 7) Part
-    // check move counter
-    if (fenParts.size() >= 4 + optionalInbetweenFields && !check_digit_field(fenParts[fenParts.size() - 1 - optionalTrailingFields]))
-    {
-        std::cerr << "Invalid move counter: '" << fenParts[fenParts.size()-1] << "'." << std::endl;
-        return FEN_INVALID_MOVE_COUNTER;
-    }
+        games.push_back(std::move(current));
+        current = Game();
+        inGame = replaying = false;
+        ravDepth = 0;
+    }
+
+    Thread* thread;
+    Notation notation;
+    bool keepPositions;
+    State state = MOVETEXT;
+    char previous = '\n';
+    int ravDepth = 0;
+    bool inGame = false, replaying = false;
+    std::string token, key, value;
+    Game current;
+    std::deque<Game> games;
+    std::unique_ptr<Position> pos;
+    StateListPtr states;
+};
 
-    return FEN_OK;
-}
-} // namespace FEN
+} // namespace PGN
 
 } // namespace Stockfish
 
@@ -0,0 +1,137 @@
+/*
+  Fairy-Stockfish, a UCI chess variant playing engine derived from Stockfish
+  Copyright (C) 2018-2022 Fabian Fichter
+
+  Fairy-Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Fairy-Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CPU_H_INCLUDED
+#define CPU_H_INCLUDED
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#  define CPU_X86_64
+#  if defined(_MSC_VER)
+#    include <intrin.h>
+#  else
+#    include <cpuid.h>
+#  endif
+#endif
+
+/// CPU feature detection at runtime. It is header-only, so that it can be used
+/// without the rest of the engine, e.g. to choose which build of it to load.
+
+namespace Stockfish::CPU {
+
+struct Features {
+  bool sse2 = false, ssse3 = false, sse41 = false, popcnt = false;
+  bool avx2 = false, bmi1 = false, bmi2 = false;
+  bool fastPext = false; // pext is microcoded on AMD CPUs before Zen 3
+  bool avx512 = false;   // AVX-512 F and BW
+  bool vnni512 = false;  // AVX-512 VNNI, DQ and VL
+};
+
+#ifdef CPU_X86_64
+
+inline void cpuid(uint32_t leaf, uint32_t regs[4]) {
+#if defined(_MSC_VER)
+  __cpuidex(reinterpret_cast<int*>(regs), int(leaf), 0);
+#else
+  __cpuid_count(leaf, 0, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+// The register state the OS saves on context switches, see XGETBV
+inline uint64_t xgetbv() {
+#if defined(_MSC_VER)
+  return _xgetbv(0);
+#else
+  uint32_t eax, edx;
+  __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+  return (uint64_t(edx) << 32) | eax;
+#endif
+}
+
+inline Features detect() {
+  Features f;
+  uint32_t regs[4];
+
+  cpuid(0, regs);
+  uint32_t maxLeaf = regs[0];
+  char vendor[13] = {};
+  std::memcpy(vendor, &regs[1], 4);
+  std::memcpy(vendor + 4, &regs[3], 4);
+  std::memcpy(vendor + 8, &regs[2], 4);
+
+  cpuid(1, regs);
+  uint32_t family = (regs[0] >> 8) & 0xF;
+  if (family == 0xF)
+      family += (regs[0] >> 20) & 0xFF;
+  f.sse2   = regs[3] & (1 << 26);
+  f.ssse3  = regs[2] & (1 << 9);
+  f.sse41  = regs[2] & (1 << 19);
+  f.popcnt = regs[2] & (1 << 23);
+  uint64_t osState = (regs[2] & (1 << 27)) ? xgetbv() : 0;
+  bool avxState = (osState & 0x6) == 0x6;
+  bool avx512State = (osState & 0xE6) == 0xE6;
+
+  if (maxLeaf >= 7)
+  {
+      cpuid(7, regs);
+      f.avx2 = avxState && (regs[1] & (1 << 5));
+      f.bmi1 = regs[1] & (1 << 3);
+      f.bmi2 = regs[1] & (1 << 8);
+      f.avx512 = avx512State && (regs[1] & (1 << 16)) && (regs[1] & (1 << 30));
+      f.vnni512 = f.avx512 && (regs[2] & (1 << 11)) && (regs[1] & (1 << 17)) && (regs[1] & (1u << 31));
+  }
+  f.fastPext = f.bmi2 && !(std::strcmp(vendor, "AuthenticAMD") == 0 && family < 0x19);
+  return f;
+}
+
+#else
+
+inline Features detect() { return Features(); }
+
+#endif
+
+/// supported_archs() lists the ARCH values of the Makefile that run on this CPU,
+/// fastest first. Only the architectures of fat binaries and pyffish are included.
+inline std::vector<std::string> supported_archs(const Features& f) {
+  std::vector<std::string> archs;
+#ifdef CPU_X86_64
+  // The builds from x86-64-avx2 on are compiled with -mavx2 -mbmi
+  bool avx2 = f.avx2 && f.bmi1 && f.sse41 && f.popcnt;
+  bool pext = avx2 && f.bmi2 && f.fastPext;
+  if (pext && f.vnni512)
+      archs.push_back("x86-64-vnni512");
+  if (pext && f.avx512)
+      archs.push_back("x86-64-avx512");
+  if (pext)
+      archs.push_back("x86-64-bmi2");
+  if (avx2)
+      archs.push_back("x86-64-avx2");
+  if (f.sse41 && f.ssse3 && f.popcnt)
+      archs.push_back("x86-64-sse41-popcnt");
+  archs.push_back("x86-64");
+#endif
+  return archs;
+}
+
+} // namespace Stockfish::CPU
+
+#endif // #ifndef CPU_H_INCLUDED
@@ -1558,8 +1558,26 @@ make_v:
 Value Eval::evaluate(const Position& pos) {
 
   Value v;
+  Thread* th = pos.this_thread();
+  bool nnueEval = Eval::useNNUE && pos.nnue_applicable();
+
+  // The cached value depends on the dynamic contempt and, by the choice between
+  // classical and NNUE evaluation, on the rule50 counter. Damping is applied later.
+  Key cacheKey = 0;
+  CacheEntry* ce = nullptr;
+  if (th->useEvalCache)
+  {
+      cacheKey = pos.key() ^ make_key((uint64_t(nnueEval ? pos.rule50_count() : 0) << 32) | uint32_t(th->trend));
+      ce = th->evalCache[cacheKey];
+      ++th->evalCache.probes;
+  }
 
-  if (!Eval::useNNUE || !pos.nnue_applicable())
+  if (ce && ce->key == cacheKey)
+  {
+      ++th->evalCache.hits;
+      v = ce->value;
+  }
+  else if (!nnueEval)
       v = Evaluation<NO_TRACE>(pos).value();
   else
   {
@@ -1596,6 +1614,9 @@ Value Eval::evaluate(const Position& pos) {
                     : adjusted_NNUE();                   // NNUE
   }
 
+  if (ce && ce->key != cacheKey)
+      ce->key = cacheKey, ce->value = v;
+
   // Damp down the evaluation linearly when shuffling
   if (pos.n_move_rule())
   {
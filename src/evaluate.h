@@ -22,6 +22,7 @@
 #include <string>
 #include <optional>
 
+#include "misc.h"
 #include "types.h"
 
 #include "variant.h"
@@ -38,6 +39,15 @@ namespace Eval {
   extern bool useNNUE;
   extern std::string eval_file_loaded;
 
+  /// CacheEntry is an entry of the per-thread evaluation cache, which keeps the
+  /// static evaluations of variants where they are expensive to compute.
+  struct CacheEntry {
+    Key key;
+    Value value;
+  };
+
+  typedef HashTable<CacheEntry, 32768> Cache;
+
   // The default net name MUST follow the format nn-[SHA256 first 12 digits].nnue
   // for the build process (profile-build and fishtest) to work. Do not change the
   // name of the macro, as it is used in the Makefile.
@@ -0,0 +1,110 @@
+/*
+  Fairy-Stockfish, a UCI chess variant playing engine derived from Stockfish
+  Copyright (C) 2018-2022 Fabian Fichter
+
+  Fairy-Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Fairy-Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include "cpu.h"
+
+/// Entry point of a fat binary (make build ARCH=x86-64-fat). The engine is linked
+/// in once per architecture, each build with its own entry point and with its
+/// static constructors in a section fat_init_<arch>. We run the constructors and
+/// the entry point of the fastest build the CPU supports, so the other builds
+/// never touch the CPU. The environment variable STOCKFISH_ARCH selects a build.
+
+using namespace Stockfish;
+
+typedef void (*InitFunc)(int, char**, char**);
+
+#define FAT_BUILD(name) \
+  extern "C" { \
+    extern InitFunc __start_fat_init_##name[] __attribute__((weak)); \
+    extern InitFunc __stop_fat_init_##name[] __attribute__((weak)); \
+    int fat_main_##name(int argc, char* argv[]); \
+  }
+
+// Keep in sync with FAT_ARCHS in the Makefile
+FAT_BUILD(x86_64_vnni512)
+FAT_BUILD(x86_64_avx512)
+FAT_BUILD(x86_64_bmi2)
+FAT_BUILD(x86_64_avx2)
+FAT_BUILD(x86_64_sse41_popcnt)
+FAT_BUILD(x86_64)
+
+#undef FAT_BUILD
+
+namespace {
+
+struct Build {
+  const char* arch;
+  InitFunc* initBegin;
+  InitFunc* initEnd;
+  int (*main)(int, char**);
+};
+
+#define FAT_BUILD(name, arch) { arch, __start_fat_init_##name, __stop_fat_init_##name, fat_main_##name }
+
+const Build Builds[] = {
+  FAT_BUILD(x86_64_vnni512, "x86-64-vnni512"),
+  FAT_BUILD(x86_64_avx512, "x86-64-avx512"),
+  FAT_BUILD(x86_64_bmi2, "x86-64-bmi2"),
+  FAT_BUILD(x86_64_avx2, "x86-64-avx2"),
+  FAT_BUILD(x86_64_sse41_popcnt, "x86-64-sse41-popcnt"),
+  FAT_BUILD(x86_64, "x86-64")
+};
+
+#undef FAT_BUILD
+
+const Build* find_build(const std::string& arch) {
+  for (const Build& b : Builds)
+      if (arch == b.arch)
+          return &b;
+  return nullptr;
+}
+
+} // namespace
+
+int main(int argc, char* argv[], char* envp[]) {
+
+  const Build* build = nullptr;
+
+  if (const char* env = std::getenv("STOCKFISH_ARCH"); env && *env)
+  {
+      if (!(build = find_build(env)))
+      {
+          std::cerr << "No build for STOCKFISH_ARCH=" << env << std::endl;
+          return EXIT_FAILURE;
+      }
+  }
+  else
+      for (const std::string& arch : CPU::supported_archs(CPU::detect()))
+          if ((build = find_build(arch)))
+              break;
+
+  if (!build)
+  {
+      std::cerr << "No build for this CPU" << std::endl;
+      return EXIT_FAILURE;
+  }
+
+  for (InitFunc* f = build->initBegin; f != build->initEnd; ++f)
+      (*f)(argc, argv, envp);
+
+  return build->main(argc, argv);
+}
@@ -0,0 +1,398 @@
+/*
+  Fairy-Stockfish, a UCI chess variant playing engine derived from Stockfish
+  Copyright (C) 2018-2022 Fabian Fichter
+
+  Fairy-Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Fairy-Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef FEN_H_INCLUDED
+#define FEN_H_INCLUDED
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "types.h"
+#include "variant.h"
+
+namespace Stockfish {
+
+namespace FEN {
+
+enum FenValidation : int {
+    FEN_INVALID_COUNTING_RULE = -14,
+    FEN_INVALID_CHECK_COUNT = -13,
+    FEN_INVALID_NB_PARTS = -11,
+    FEN_INVALID_CHAR = -10,
+    FEN_TOUCHING_KINGS = -9,
+    FEN_INVALID_BOARD_GEOMETRY = -8,
+    FEN_INVALID_POCKET_INFO = -7,
+    FEN_INVALID_SIDE_TO_MOVE = -6,
+    FEN_INVALID_CASTLING_INFO = -5,
+    FEN_INVALID_EN_PASSANT_SQ = -4,
+    FEN_INVALID_NUMBER_OF_KINGS = -3,
+    FEN_INVALID_HALF_MOVE_COUNTER = -2,
+    FEN_INVALID_MOVE_COUNTER = -1,
+    FEN_EMPTY = 0,
+    FEN_OK = 1
+};
+enum Validation : int {
+    NOK,
+    OK
+};
+
+inline std::string get_valid_special_chars(const Variant* v) {
+    std::string validSpecialCharactersFirstField = "/";
+    // Whether or not '-', '+', '~', '[', ']' are valid depends on the variant being played.
+    if (v->shogiStylePromotions)
+        validSpecialCharactersFirstField += '+';
+    if (!v->promotionPieceTypes.empty())
+        validSpecialCharactersFirstField += '~';
+    if (!v->freeDrops && (v->pieceDrops || v->seirawanGating || v->arrowGating))
+        validSpecialCharactersFirstField += "[-]";
+    return validSpecialCharactersFirstField;
+}
+
+/// FenValidator checks FENs of a variant without allocations and returns the first
+/// failed check. The properties of the variant and its starting position are
+/// prepared once, so one validator should be used for all FENs of a variant.
+class FenValidator {
+
+    static constexpr int MaxParts = 8;
+    static constexpr int NoSquare = -1;
+
+public:
+    FenValidator(const Variant* variant, bool is960) : v(variant), chess960(is960) {
+        nbRanks = v->maxRank + 1;
+        nbFiles = v->maxFile + 1;
+        for (const std::string& chars : {v->pieceToChar, v->pieceToCharSynonyms})
+            for (char c : chars)
+                pieceChars[uint8_t(c)] = true;
+        for (char c : get_valid_special_chars(v))
+            specialChars[uint8_t(c)] = true;
+        for (int c = 0; c < 256; ++c)
+            validChars[c] = pieceChars[c] || specialChars[c] || isdigit(c);
+
+        std::string_view startFen(v->startFen);
+        std::string_view startBoardPart = startFen.substr(0, startFen.find(' '));
+        for (Color c : {WHITE, BLACK})
+        {
+            kingChar[c] = v->pieceToChar[make_piece(c, KING)];
+            startKings[c] = std::count(startBoardPart.begin(), startBoardPart.end(), kingChar[c]);
+        }
+
+        // Starting squares of the castling pieces
+        std::array<char, FILE_NB * RANK_NB> startBoard;
+        int ranks;
+        fill_board(startFen, startBoard.data(), ranks);
+        for (Color c : {WHITE, BLACK})
+        {
+            kingStart[c] = find(startBoard.data(), v->pieceToChar[make_piece(c, v->castlingKingPiece)]);
+            char rookChar = v->pieceToChar[make_piece(c, v->castlingRookPiece)];
+            rookStart[c][0] = find(startBoard.data(), rookChar);
+            rookStart[c][1] = rookStart[c][0] == NoSquare ? NoSquare : find(startBoard.data(), rookChar, rookStart[c][0] + 1);
+        }
+    }
+
+    bool is_chess960() const { return chess960; }
+
+    FenValidation validate(std::string_view fen) const {
+
+        if (fen.empty())
+            return FEN_EMPTY;
+
+        // Split into parts like std::getline(), i.e., without a part after a trailing space
+        std::array<std::string_view, MaxParts> parts;
+        size_t nbParts = 0;
+        for (size_t start = 0; start < fen.size(); )
+        {
+            size_t end = std::min(fen.find(' ', start), fen.size());
+            if (nbParts == MaxParts)
+                return FEN_INVALID_NB_PARTS;
+            parts[nbParts++] = fen.substr(start, end - start);
+            start = end + 1;
+        }
+        if (nbParts > 6 + size_t(v->checkCounting))
+            return FEN_INVALID_NB_PARTS;
+
+        // 1) Board and pocket
+        const std::string_view boardPart = parts[0];
+        int slashes = 0, brackets = 0, kings[COLOR_NB] = {0, 0};
+        for (char c : boardPart)
+        {
+            if (!validChars[uint8_t(c)])
+                return FEN_INVALID_CHAR;
+            slashes += c == '/';
+            brackets += c == '[';
+            kings[WHITE] += c == kingChar[WHITE];
+            kings[BLACK] += c == kingChar[BLACK];
+        }
+
+        std::array<char, FILE_NB * RANK_NB> board;
+        int ranks;
+        if (fill_board(boardPart, board.data(), ranks) == NOK)
+            return FEN_INVALID_BOARD_GEOMETRY;
+        if (v->pieceDrops ? ranks + 1 != nbRanks && ranks != nbRanks : ranks + 1 != nbRanks)
+            return FEN_INVALID_BOARD_GEOMETRY;
+
+        int pocketKings[COLOR_NB] = {0, 0};
+        if (v->pieceDrops || v->seirawanGating || v->arrowGating)
+        {
+            char stopChar = slashes == nbRanks ? '/' : brackets == 1 ? '[' : 0;
+            if (stopChar == '[' && boardPart.back() != ']')
+                return FEN_INVALID_POCKET_INFO;
+            if (stopChar)
+                for (size_t i = boardPart.size() - (stopChar == '['); boardPart[--i] != stopChar; )
+                {
+                    char c = boardPart[i];
+                    if (c != '-' && !pieceChars[uint8_t(c)])
+                        return FEN_INVALID_POCKET_INFO;
+                    pocketKings[WHITE] += c == kingChar[WHITE];
+                    pocketKings[BLACK] += c == kingChar[BLACK];
+                }
+        }
+
+        if (v->pieceTypes.find(KING) != v->pieceTypes.end())
+        {
+            if (kings[WHITE] != startKings[WHITE] || kings[BLACK] != startKings[BLACK])
+                return FEN_INVALID_NUMBER_OF_KINGS;
+
+            if (   v->kingType == KING
+                && kings[WHITE] - pocketKings[WHITE] == 1
+                && kings[BLACK] - pocketKings[BLACK] == 1
+                && distance(find(board.data(), kingChar[WHITE]), find(board.data(), kingChar[BLACK])) <= 2)
+                return FEN_TOUCHING_KINGS;
+        }
+
+        // 2) Side to move
+        if (nbParts >= 2 && first(parts[1]) != 'w' && first(parts[1]) != 'b')
+            return FEN_INVALID_SIDE_TO_MOVE;
+
+        // Castling and en passant can be skipped
+        bool skipCastlingAndEp = nbParts >= 4 && nbParts <= 5 && isdigit(uint8_t(first(parts[2])));
+
+        // 3) Castling rights
+        if (nbParts >= 3 && !skipCastlingAndEp && v->castling)
+        {
+            bool flags[COLOR_NB] = {false, false}, sides[COLOR_NB][2] = {};
+            for (char c : parts[2])
+                if (c != '-')
+                {
+                    if (!isalpha(uint8_t(c)))
+                        return FEN_INVALID_CASTLING_INFO;
+                    Color us = isupper(uint8_t(c)) ? WHITE : BLACK;
+                    char flag = tolower(c);
+                    flags[us] = true;
+                    sides[us][0] |= flag == 'q';
+                    sides[us][1] |= flag == 'k';
+                    if (check_castling_flag(board.data(), us, flag) == NOK)
+                        return FEN_INVALID_CASTLING_INFO;
+                }
+
+            // Only check exact squares if the starting squares of the castling pieces are known
+            if ((flags[WHITE] || flags[BLACK]) && !v->chess960 && !v->castlingDroppedPiece && !chess960)
+                for (Color c : {WHITE, BLACK})
+                {
+                    if (!flags[c])
+                        continue;
+                    if (find(board.data(), castling_king_char(c)) != kingStart[c])
+                        return FEN_INVALID_CASTLING_INFO;
+                    char rookChar = v->pieceToChar[make_piece(c, v->castlingRookPiece)];
+                    for (int side : {0, 1})
+                        if (sides[c][side] && (rookStart[c][side] == NoSquare || board[rookStart[c][side]] != rookChar))
+                            return FEN_INVALID_CASTLING_INFO;
+                }
+        }
+
+        // 4) En passant square or counting rule
+        if (nbParts >= 4 && !skipCastlingAndEp)
+        {
+            const std::string_view ep = parts[3];
+            if (v->doubleStep && v->pieceTypes.find(PAWN) != v->pieceTypes.end())
+            {
+                if (ep != "-" && (ep.size() != 2 || !isalpha(uint8_t(ep[0])) || !isdigit(uint8_t(ep[1]))))
+                    return FEN_INVALID_EN_PASSANT_SQ;
+            }
+            else if (v->countingRule && !is_digit_field(ep))
+                return FEN_INVALID_COUNTING_RULE;
+        }
+
+        // 5) Check count, either before the move counters or in lichess style after them
+        size_t optionalInbetweenFields = 2 * !skipCastlingAndEp;
+        size_t optionalTrailingFields = 0;
+        if (nbParts >= 3 + optionalInbetweenFields && v->checkCounting && nbParts % 2)
+        {
+            const std::string_view checks = parts[2 + optionalInbetweenFields];
+            if (checks.size() == 3 && isdigit(uint8_t(checks[0])) && isdigit(uint8_t(checks[2])))
+                optionalInbetweenFields++;
+            else
+            {
+                const std::string_view lichessChecks = parts[nbParts - 1];
+                if (   nbParts < 5 + optionalInbetweenFields
+                    || lichessChecks.size() != 4
+                    || !isdigit(uint8_t(lichessChecks[1])) || lichessChecks[1] > '3'
+                    || !isdigit(uint8_t(lichessChecks[3])) || lichessChecks[3] > '3')
+                    return FEN_INVALID_CHECK_COUNT;
+                optionalTrailingFields++;
+            }
+        }
+
+        // 6) Half move counter and 7) move counter
+        if (nbParts >= 3 + optionalInbetweenFields && !is_digit_field(parts[nbParts - 2 - optionalTrailingFields]))
+            return FEN_INVALID_HALF_MOVE_COUNTER;
+        if (nbParts >= 4 + optionalInbetweenFields && !is_digit_field(parts[nbParts - 1 - optionalTrailingFields]))
+            return FEN_INVALID_MOVE_COUNTER;
+
+        return FEN_OK;
+    }
+
+private:
+    // Places the pieces on a board indexed by row * files + file, where row 0 is
+    // the first rank, and returns the index of the last rank read.
+    Validation fill_board(std::string_view fenBoard, char* board, int& rankIdx) const {
+        std::fill(board, board + nbRanks * nbFiles, ' ');
+        rankIdx = 0;
+        int fileIdx = 0;
+        char prevChar = '?';
+        for (char c : fenBoard)
+        {
+            if (c == ' ' || c == '[')
+                break;
+            if (isdigit(uint8_t(c)))
+            {
+                fileIdx += c - '0';
+                if (isdigit(uint8_t(prevChar)))
+                    fileIdx += 9 * (prevChar - '0');
+            }
+            else if (c == '/')
+            {
+                ++rankIdx;
+                if (fileIdx != nbFiles)
+                    return NOK;
+                if (rankIdx == nbRanks)
+                    break;
+                fileIdx = 0;
+            }
+            else if (!specialChars[uint8_t(c)])
+            {
+                if (fileIdx == nbFiles)
+                    return NOK;
+                int idx = (v->maxRank - rankIdx) * nbFiles + fileIdx;
+                if (idx >= 0 && idx < nbRanks * nbFiles)
+                    board[idx] = c;
+                ++fileIdx;
+            }
+            prevChar = c;
+        }
+        return OK;
+    }
+
+    Validation check_castling_flag(const char* board, Color c, char flag) const {
+        const int castlingRank = relative_rank(c, v->castlingRank, v->maxRank);
+        if (flag == 'k' || flag == 'q')
+        {
+            int king = find(board, castling_king_char(c));
+            if (king == NoSquare || king / nbFiles != castlingRank)
+                return NOK;
+            // Look for a castling rook between the king and the edge of the board
+            char rookChar = v->pieceToChar[make_piece(c, v->castlingRookPiece)];
+            for (int f = flag == 'k' ? nbFiles - 1 : 0; f != king % nbFiles; flag == 'k' ? f-- : f++)
+                if (board[castlingRank * nbFiles + f] == rookChar)
+                    return OK;
+            return NOK;
+        }
+        // Gating flag
+        int idx = castlingRank * nbFiles + (flag - 'a');
+        return idx >= 0 && idx < nbRanks * nbFiles && board[idx] != ' ' ? OK : NOK;
+    }
+
+    char castling_king_char(Color c) const {
+        char king = v->pieceToChar[v->castlingKingPiece];
+        return c == WHITE ? toupper(king) : tolower(king);
+    }
+
+    int find(const char* board, char piece, int from = 0) const {
+        for (int idx = from; idx < nbRanks * nbFiles; ++idx)
+            if (board[idx] == piece)
+                return idx;
+        return NoSquare;
+    }
+
+    // Squared distance, where squares not found count as row and file -1
+    int distance(int s1, int s2) const {
+        int r1 = s1 == NoSquare ? -1 : s1 / nbFiles, f1 = s1 == NoSquare ? -1 : s1 % nbFiles;
+        int r2 = s2 == NoSquare ? -1 : s2 / nbFiles, f2 = s2 == NoSquare ? -1 : s2 % nbFiles;
+        return (r1 - r2) * (r1 - r2) + (f1 - f2) * (f1 - f2);
+    }
+
+    static char first(std::string_view part) {
+        return part.empty() ? '\0' : part[0];
+    }
+
+    static bool is_digit_field(std::string_view field) {
+        return field == "-" || std::all_of(field.begin(), field.end(), [](char c) { return isdigit(uint8_t(c)); });
+    }
+
+    const Variant* v;
+    bool chess960;
+    int nbRanks, nbFiles;
+    std::array<bool, 256> pieceChars = {}, specialChars = {}, validChars = {};
+    char kingChar[COLOR_NB];
+    int startKings[COLOR_NB];
+    int kingStart[COLOR_NB];
+    int rookStart[COLOR_NB][2];
+};
+
+inline const char* fen_validation_reason(FenValidation result) {
+    switch (result)
+    {
+    case FEN_INVALID_COUNTING_RULE:     return "Invalid counting rule field.";
+    case FEN_INVALID_CHECK_COUNT:       return "Invalid check count.";
+    case FEN_INVALID_NB_PARTS:          return "Invalid number of fen parts.";
+    case FEN_INVALID_CHAR:              return "Invalid piece character.";
+    case FEN_TOUCHING_KINGS:            return "King pieces are next to each other.";
+    case FEN_INVALID_BOARD_GEOMETRY:    return "Invalid board geometry, the number of ranks or files does not match the variant.";
+    case FEN_INVALID_POCKET_INFO:       return "Invalid pocket specification.";
+    case FEN_INVALID_SIDE_TO_MOVE:      return "Invalid side to move specification.";
+    case FEN_INVALID_CASTLING_INFO:     return "Invalid castling specification, or the castling pieces have moved.";
+    case FEN_INVALID_EN_PASSANT_SQ:     return "Invalid en-passant square.";
+    case FEN_INVALID_NUMBER_OF_KINGS:   return "Invalid number of kings.";
+    case FEN_INVALID_HALF_MOVE_COUNTER: return "Invalid half move counter.";
+    case FEN_INVALID_MOVE_COUNTER:      return "Invalid move counter.";
+    case FEN_EMPTY:                     return "Fen is empty.";
+    default:                            return "";
+    }
+}
+
+/// check_fen() checks a single FEN. The validator is kept for the next call,
+/// since preparing it costs more than most checks. Variants are told apart by id,
+/// as a reloaded variant can have the address of a previous one.
+inline FenValidation check_fen(std::string_view fen, const Variant* v, bool chess960 = false) {
+    thread_local std::optional<FenValidator> validator;
+    thread_local size_t variantId;
+    if (!validator || variantId != v->id || validator->is_chess960() != chess960)
+    {
+        validator.emplace(v, chess960);
+        variantId = v->id;
+    }
+    return validator->validate(fen);
+}
+} // namespace FEN
+
+} // namespace Stockfish
+
+#endif // #ifndef FEN_H_INCLUDED
@@ -81,10 +81,14 @@ class Board {
 private:
   const Variant* v;
   StateListPtr states;
-  Position pos;
-  Thread* thread;
+  std::unique_ptr<Position> position;  // owned on the heap so replayed games can hand theirs over
+  Position& pos;
+  Thread* thread = nullptr;
   std::vector<Move> moveStack;
   bool is960;
+  // backing memory of the typed array views
+  std::vector<uint32_t> moveBuffer;
+  std::vector<int8_t> planeBuffer;
 
 public:
   static bool sfInitialized;
@@ -101,7 +105,7 @@ public:
     Board(uciVariant, fen, false) {
   }
 
-  Board(std::string uciVariant, std::string fen, bool is960) {
+  Board(std::string uciVariant, std::string fen, bool is960) : position(new Position), pos(*position) {
     init(uciVariant, fen, is960);
   }
 
@@ -117,14 +121,33 @@ public:
 
   std::string legal_moves_san() {
     std::string movesSan;
-    for (const ExtMove& move : MoveList<LEGAL>(this->pos)) {
-      movesSan += SAN::move_to_san(this->pos, move, NOTATION_SAN);
+    for (const std::string& san : SAN::all_moves_to_san(this->pos, MoveList<LEGAL>(this->pos), NOTATION_SAN)) {
+      movesSan += san;
       movesSan += DELIM;
     }
     save_pop_back(movesSan);
     return movesSan;
   }
 
+  // The array views below point into the wasm memory, so they are only valid until the
+  // board is changed or deleted, or the memory grows. Use slice() to keep a copy.
+
+  // Returns the legal moves in the packed encoding of the engine, in the order of legal_moves().
+  // The encoding depends on the build, so the moves are read with decodeMove().
+  val legal_moves_array() {
+    moveBuffer.clear();
+    for (const ExtMove& move : MoveList<LEGAL>(this->pos))
+      moveBuffer.push_back(uint32_t(Move(move)));
+    return val(typed_memory_view(moveBuffer.size(), moveBuffer.data()));
+  }
+
+  // Returns the piece and pocket planes of the position in the layout of board_planes().
+  val planes() {
+    planeBuffer.resize(plane_count(v) * (v->maxFile + 1) * (v->maxRank + 1));
+    board_planes(this->pos, planeBuffer.data());
+    return val(typed_memory_view(planeBuffer.size(), planeBuffer.data()));
+  }
+
   int number_legal_moves() const {
     return MoveList<LEGAL>(pos).size();
   }
@@ -141,16 +164,9 @@ public:
     return push_san(sanMove, NOTATION_SAN);
   }
 
-  // TODO: This is a naive implementation which compares all legal SAN moves with the requested string.
-  // If the SAN move wasn't found the position remains unchanged. Alternatively, implement a direct conversion.
+  // If the SAN move wasn't found the position remains unchanged.
   bool push_san(std::string sanMove, Notation notation) {
-    Move foundMove = MOVE_NONE;
-    for (const ExtMove& move : MoveList<LEGAL>(pos)) {
-      if (sanMove == SAN::move_to_san(this->pos, move, notation)) {
-        foundMove = move;
-        break;
-      }
-    }
+    const Move foundMove = SAN::san_to_move(this->pos, sanMove, notation);
     if (is_move_none<false>(foundMove, sanMove, pos))
       return false;
     do_move(foundMove);
@@ -185,6 +201,27 @@ public:
     pos.set(v, fen, is960, &states->back(), thread);
   }
 
+  val pack() const {
+    std::vector<uint8_t> data(Position::packed_size(v));
+    pos.pack(data.data());
+    return val::global("Uint8Array").new_(typed_memory_view(data.size(), data.data()));
+  }
+
+  bool set_packed(val packed) {
+    std::vector<uint8_t> data = vecFromJSArray<uint8_t>(packed);
+    if (data.size() != Position::packed_size(v))
+      return false;
+    // Invalid data must not destroy the current position and its move stack
+    Position check;
+    StateInfo st;
+    if (!check.unpack(v, data.data(), is960, &st, thread))
+      return false;
+    resetStates();
+    moveStack.clear();
+    pos.unpack(v, data.data(), is960, &states->back(), thread);
+    return true;
+  }
+
   // note: const identifier for pos not possible due to SAN::move_to_san()
   std::string san_move(std::string uciMove) {
     return san_move(uciMove, NOTATION_SAN);
@@ -342,6 +379,10 @@ public:
     return moves;
   }
 
+  val move_stack_array() const {
+    return val(typed_memory_view(moveStack.size(), reinterpret_cast<const uint32_t*>(moveStack.data())));
+  }
+
   void push_moves(std::string uciMoves) {
     std::stringstream ss(uciMoves);
     std::string uciMove;
@@ -350,6 +391,43 @@ public:
     }
   }
 
+  val replay_game(std::string uciMoves) {
+    return replay_game(uciMoves, NOTATION_DEFAULT);
+  }
+
+  // Pushes the moves and returns the FEN, SAN, check and game end status per ply.
+  // If a move is invalid, the moves up to that move are pushed.
+  val replay_game(std::string uciMoves, Notation notation) {
+    std::vector<std::string> moves;
+    std::stringstream ss(uciMoves);
+    std::string uciMove;
+    while (std::getline(ss, uciMove, ' '))
+      if (!uciMove.empty())
+        moves.push_back(uciMove);
+    if (notation == NOTATION_DEFAULT)
+      notation = default_notation(v);
+
+    GameReplay replay;
+    size_t plies = Stockfish::replay_game(this->pos, this->states, moves, notation, replay);
+    this->moveStack.insert(this->moveStack.end(), replay.moves.begin(), replay.moves.end());
+    if (plies < moves.size())
+      is_move_none<true>(MOVE_NONE, moves[plies], pos);
+
+    val fens = val::array();
+    val sans = val::array();
+    for (size_t i = 0; i < plies; ++i) {
+      fens.set(i, replay.fens[i]);
+      sans.set(i, replay.sans[i]);
+    }
+    val result = val::object();
+    result.set("fens", fens);
+    result.set("sans", sans);
+    result.set("checks", val::global("Uint8Array").new_(typed_memory_view(plies, replay.checks.data())));
+    result.set("gameEnds", val::global("Uint8Array").new_(typed_memory_view(plies, replay.gameEnds.data())));
+    result.set("results", val::global("Int32Array").new_(typed_memory_view(plies, replay.results.data())));
+    return result;
+  }
+
   void push_san_moves(std::string sanMoves) {
     return push_san_moves(sanMoves, NOTATION_SAN);
   }
@@ -411,10 +489,17 @@ public:
   }
 
 private:
+  // Takes over a position replayed by the PGN reader along with its states
+  Board(const Variant* v, bool is960, std::unique_ptr<Position> p, StateListPtr s, std::vector<Move> line) :
+    v(v), states(std::move(s)), position(std::move(p)), pos(*position), moveStack(std::move(line)), is960(is960) {
+  }
+
   void resetStates() {
     this->states = StateListPtr(new std::deque<StateInfo>(1));
   }
 
+  friend class PgnReader;
+
   void do_move(Move move) {
     states->emplace_back();
     this->pos.do_move(move, states->back());
@@ -469,6 +554,27 @@ namespace ffish {
     Board::sfInitialized = true;
   }
 
+  std::string plane_pieces(std::string uciVariant) {
+    std::string pieces;
+    for (const std::string& piece : Stockfish::plane_pieces(get_variant(uciVariant))) {
+      pieces += piece;
+      pieces += DELIM;
+    }
+    save_pop_back(pieces);
+    return pieces;
+  }
+
+  // Reads a move of legalMovesArray() or moveStackArray() of a board of the variant
+  val decode_move(std::string uciVariant, uint32_t move) {
+    DecodedMove m = Stockfish::decode_move(get_variant(uciVariant), Move(move));
+    val result = val::object();
+    result.set("from", m.from);
+    result.set("to", m.to);
+    result.set("type", std::string(m.type));
+    result.set("piece", m.piece);
+    return result;
+  }
+
   bool captures_to_hand(std::string uciVariant) {
     const Variant* v = get_variant(uciVariant);
     return v->capturesToHand;
@@ -491,6 +597,37 @@ namespace ffish {
   int validate_fen(std::string fen) {
     return validate_fen(fen, "chess");
   }
+
+  // validates newline separated FENs and returns the results as an Int8Array
+  val validate_fens(std::string fens, std::string uciVariant, bool chess960) {
+    const FEN::FenValidator validator(get_variant(uciVariant), chess960);
+    std::vector<int8_t> results;
+    std::string_view remaining(fens);
+    while (!remaining.empty()) {
+      size_t end = std::min(remaining.find('\n'), remaining.size());
+      results.push_back(int8_t(validator.validate(remaining.substr(0, end))));
+      remaining.remove_prefix(std::min(end + 1, remaining.size()));
+    }
+    return val::global("Int8Array").new_(typed_memory_view(results.size(), results.data()));
+  }
+
+  val validate_fens(std::string fens, std::string uciVariant) {
+    return validate_fens(fens, uciVariant, false);
+  }
+
+  // replays a game once, see Board::replay_game()
+  val replay_game(std::string uciVariant, std::string fen, std::string uciMoves, bool is960, Notation notation) {
+    Board board(uciVariant, fen, is960);
+    return board.replay_game(uciMoves, notation);
+  }
+
+  val replay_game(std::string uciVariant, std::string fen, std::string uciMoves, bool is960) {
+    return replay_game(uciVariant, fen, uciMoves, is960, NOTATION_DEFAULT);
+  }
+
+  val replay_game(std::string uciVariant, std::string fen, std::string uciMoves) {
+    return replay_game(uciVariant, fen, uciMoves, false);
+  }
 }
 
 class Game {
@@ -501,6 +638,7 @@ private:
   std::string fen = ""; // start pos
   bool is960 = false;
   bool parsedGame = false;
+  std::string error = "";
 public:
   std::string header_keys() {
     std::string keys;
@@ -525,7 +663,13 @@ public:
     return board->move_stack();
   }
 
+  // first problem while replaying the moves, empty if there was none
+  std::string replay_error() {
+    return error;
+  }
+
   friend Game read_game_pgn(std::string);
+  friend class PgnReader;
 };
 
 
@@ -648,7 +792,6 @@ Game read_game_pgn(std::string pgn) {
           size_t annotationChar2 = sanMove.find('!');
           if (annotationChar1 != std::string::npos || annotationChar2 != std::string::npos)
             sanMove = sanMove.substr(0, std::min(annotationChar1, annotationChar2));
-          std::cout << sanMove << " ";
           game.board->push_san(sanMove);
         }
         curIdx = sanMoveEnd+1;
@@ -662,6 +805,56 @@ Game read_game_pgn(std::string pgn) {
   return game;
 }
 
+// Streaming reader for PGN files with many games, which are fed in chunks of any size
+class PgnReader {
+private:
+  PGN::Reader reader;
+
+public:
+  PgnReader():
+    PgnReader(NOTATION_SAN) {
+  }
+
+  PgnReader(Notation notation) : reader(nullptr, notation, true) {
+    if (!Board::sfInitialized) {
+      initialize_stockfish();
+      Board::sfInitialized = true;
+    }
+  }
+
+  void feed(std::string chunk) {
+    reader.feed(chunk.data(), chunk.size());
+  }
+
+  void finish() {
+    reader.finish();
+  }
+
+  bool has_next() const {
+    return reader.has_next();
+  }
+
+  Game next() {
+    PGN::Game pgnGame;
+    Game game;
+    if (!reader.next(pgnGame))
+      return game;
+    for (const auto& [key, value] : pgnGame.headers)
+      game.header[key] = value;
+    game.variant = pgnGame.variant;
+    game.fen = pgnGame.fen;
+    game.is960 = pgnGame.chess960;
+    game.error = pgnGame.error;
+    // Missing if the variant or the start position could not be set up
+    if (pgnGame.position) {
+      game.board.reset(new Board(variants.find(game.variant)->second, game.is960, std::move(pgnGame.position),
+                                 std::move(pgnGame.states), std::move(pgnGame.line)));
+      game.parsedGame = true;
+    }
+    return game;
+  }
+};
+
 
 // binding code
 EMSCRIPTEN_BINDINGS(ffish_js) {
@@ -672,6 +865,8 @@ EMSCRIPTEN_BINDINGS(ffish_js) {
     .constructor<std::string, std::string, bool>()
     .function("legalMoves", &Board::legal_moves)
     .function("legalMovesSan", &Board::legal_moves_san)
+    .function("legalMovesArray", &Board::legal_moves_array)
+    .function("planes", &Board::planes)
     .function("numberLegalMoves", &Board::number_legal_moves)
     .function("push", &Board::push)
     .function("pushSan", select_overload<bool(std::string)>(&Board::push_san))
@@ -682,6 +877,8 @@ EMSCRIPTEN_BINDINGS(ffish_js) {
     .function("fen", select_overload<std::string()const>(&Board::fen))
     .function("fen", select_overload<std::string(bool, int)const>(&Board::fen))
     .function("setFen", &Board::set_fen)
+    .function("pack", &Board::pack)
+    .function("setPacked", &Board::set_packed)
     .function("sanMove", select_overload<std::string(std::string)>(&Board::san_move))
     .function("sanMove", select_overload<std::string(std::string, Notation)>(&Board::san_move))
     .function("variationSan", select_overload<std::string(std::string)>(&Board::variation_san))
@@ -700,7 +897,10 @@ EMSCRIPTEN_BINDINGS(ffish_js) {
     .function("isCheck", &Board::is_check)
     .function("isBikjang", &Board::is_bikjang)
     .function("moveStack", &Board::move_stack)
+    .function("moveStackArray", &Board::move_stack_array)
     .function("pushMoves", &Board::push_moves)
+    .function("replayGame", select_overload<val(std::string)>(&Board::replay_game))
+    .function("replayGame", select_overload<val(std::string, Notation)>(&Board::replay_game))
     .function("pushSanMoves", select_overload<void(std::string)>(&Board::push_san_moves))
     .function("pushSanMoves", select_overload<void(std::string, Notation)>(&Board::push_san_moves))
     .function("pocket", &Board::pocket)
@@ -710,7 +910,15 @@ EMSCRIPTEN_BINDINGS(ffish_js) {
   class_<Game>("Game")
     .function("headerKeys", &Game::header_keys)
     .function("headers", &Game::headers)
-    .function("mainlineMoves", &Game::mainline_moves);
+    .function("mainlineMoves", &Game::mainline_moves)
+    .function("error", &Game::replay_error);
+  class_<PgnReader>("PgnReader")
+    .constructor<>()
+    .constructor<Notation>()
+    .function("feed", &PgnReader::feed)
+    .function("finish", &PgnReader::finish)
+    .function("hasNext", &PgnReader::has_next)
+    .function("next", &PgnReader::next);
   // usage: e.g. ffish.Notation.DEFAULT
   enum_<Notation>("Notation")
     .value("DEFAULT", NOTATION_DEFAULT)
@@ -739,11 +947,18 @@ EMSCRIPTEN_BINDINGS(ffish_js) {
   function("readGamePGN", &read_game_pgn);
   function("variants", &ffish::available_variants);
   function("loadVariantConfig", &ffish::load_variant_config);
+  function("planePieces", &ffish::plane_pieces);
+  function("decodeMove", &ffish::decode_move);
   function("capturesToHand", &ffish::captures_to_hand);
   function("startingFen", &ffish::starting_fen);
   function("validateFen", select_overload<int(std::string)>(&ffish::validate_fen));
   function("validateFen", select_overload<int(std::string, std::string)>(&ffish::validate_fen));
   function("validateFen", select_overload<int(std::string, std::string, bool)>(&ffish::validate_fen));
+  function("validateFens", select_overload<val(std::string, std::string)>(&ffish::validate_fens));
+  function("validateFens", select_overload<val(std::string, std::string, bool)>(&ffish::validate_fens));
+  function("replayGame", select_overload<val(std::string, std::string, std::string)>(&ffish::replay_game));
+  function("replayGame", select_overload<val(std::string, std::string, std::string, bool)>(&ffish::replay_game));
+  function("replayGame", select_overload<val(std::string, std::string, std::string, bool, Notation)>(&ffish::replay_game));
   // TODO: enable to string conversion method
   // .class_function("getStringFromInstance", &Board::get_string_from_instance);
 }
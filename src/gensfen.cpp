@@ -0,0 +1,339 @@
+/*
+  Fairy-Stockfish, a UCI chess variant playing engine derived from Stockfish
+  Copyright (C) 2018-2022 Fabian Fichter
+
+  Fairy-Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Fairy-Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "misc.h"
+#include "movegen.h"
+#include "position.h"
+#include "search.h"
+#include "thread.h"
+#include "uci.h"
+
+using namespace std;
+
+namespace Stockfish {
+
+namespace {
+
+/// Training data files start with a header identifying the variant, the size
+/// of its NNUE input layer, the size of its packed positions and its number of
+/// files and ranks, followed by records of the form
+///
+/// packed position (see Position::pack())
+/// int16  search score from the point of view of the side to move
+/// best move, independent of the build:
+///   uint8 origin square (rank * files + file, 255 for drops)
+///   uint8 destination square
+///   uint8 move type (normal, en passant, castling, promotion, drop,
+///         piece promotion, piece demotion, special)
+///   uint8 promoted, dropped or gated piece type as index of the piece
+///         codes of packed positions (255 for none)
+///   uint8 square of the gated piece (255 for none)
+/// int8   game result from the point of view of the side to move (1, 0, -1)
+///
+/// All numbers are stored in little endian byte order.
+
+constexpr char     FileMagic[4] = { 'F', 'S', 'T', 'D' };
+constexpr uint32_t FileVersion = 3;
+constexpr uint8_t  NoIndex = 255;
+
+template<typename IntType>
+void append_le(string& buf, IntType value) {
+
+  for (size_t i = 0; i < sizeof(IntType); ++i)
+      buf += char(uint64_t(value) >> (8 * i));
+}
+
+
+/// append_move() writes a move in the encoding of the training data records,
+/// which does not depend on the square and move layout of the build.
+
+void append_move(string& buf, const Variant* v, Move m) {
+
+  auto index = [v](Square s) { return uint8_t(rank_of(s) * (v->maxFile + 1) + file_of(s)); };
+  PieceType pt =  type_of(m) == PROMOTION ? promotion_type(m)
+                : type_of(m) == DROP      ? dropped_piece_type(m)
+                : is_gating(m)            ? gating_type(m)
+                                          : NO_PIECE_TYPE;
+
+  buf += char(type_of(m) == DROP ? NoIndex : index(from_sq(m)));
+  buf += char(index(to_sq(m)));
+  buf += char(type_of(m) >> (2 * SQUARE_BITS));
+  buf += char(pt != NO_PIECE_TYPE ? uint8_t(v->packedPieceIndex[pt]) : NoIndex);
+  buf += char(is_gating(m) ? index(gating_square(m)) : NoIndex);
+}
+
+
+/// AsyncWriter writes buffers to a file on a thread of its own, so that
+/// the searching threads never wait for the disk.
+
+class AsyncWriter {
+
+public:
+  explicit AsyncWriter(const string& fname) : file(fname, ios::binary), writer(&AsyncWriter::loop, this) {}
+ ~AsyncWriter() {
+    {
+        lock_guard<mutex> lk(mtx);
+        finished = true;
+    }
+    cv.notify_one();
+    writer.join();
+  }
+
+  bool is_open() const { return file.is_open(); }
+
+  void push(string&& buf) {
+    {
+        lock_guard<mutex> lk(mtx);
+        queue.push_back(std::move(buf));
+    }
+    cv.notify_one();
+  }
+
+private:
+  void loop() {
+    while (true)
+    {
+        unique_lock<mutex> lk(mtx);
+        cv.wait(lk, [&]{ return finished || !queue.empty(); });
+
+        if (queue.empty())
+            return;
+
+        vector<string> bufs;
+        bufs.swap(queue);
+        lk.unlock();
+
+        for (const string& buf : bufs)
+            file.write(buf.data(), streamsize(buf.size()));
+    }
+  }
+
+  ofstream file;
+  mutex mtx;
+  condition_variable cv;
+  vector<string> queue;
+  bool finished = false;
+  thread writer;
+};
+
+
+/// TrainingDataGenerator plays self-play games on every thread and records
+/// the positions with their search scores and the final game results.
+
+struct TrainingDataGenerator : public BatchJob {
+
+  static constexpr size_t BufferSize = 1 << 20;
+
+  TrainingDataGenerator(const Variant* v, bool c960, AsyncWriter& w) : variant(v), chess960(c960), writer(w) {}
+
+  void run(Thread& th) override;
+
+  const Variant* variant;
+  bool chess960;
+  uint64_t count = 1000000;
+  int randomPlies = 8;
+  int maxPly = 400;
+  Value evalLimit = Value(3000);
+  atomic<uint64_t> generated{0};
+
+private:
+  struct Record {
+    size_t offset; // Of the packed position in the game buffer
+    Value score;
+    Move move;
+    Color sideToMove;
+  };
+
+  AsyncWriter& writer;
+};
+
+
+void TrainingDataGenerator::run(Thread& th) {
+
+  PRNG rng(now() ^ ((th.id() + 1) * 0x9E3779B97F4A7C15ULL));
+  const size_t packedSize = Position::packed_size(variant);
+  vector<Record> game;
+  vector<uint8_t> packed;
+  string buf;
+
+  while (generated < count)
+  {
+      StateListPtr states(new deque<StateInfo>(1));
+      Position& pos = th.rootPos;
+      pos.set(variant, variant->startFen, chess960, &states->back(), &th);
+      game.clear();
+      packed.clear();
+
+      // Game result from the point of view of the side to move at the end
+      Value result = VALUE_DRAW;
+
+      for (int ply = 0; ; ++ply)
+      {
+          Move m = MOVE_NONE;
+
+          if (pos.is_game_end(result))
+              break;
+
+          if (ply >= maxPly)
+          {
+              result = VALUE_DRAW;
+              break;
+          }
+
+          if (ply < randomPlies)
+          {
+              MoveList<LEGAL> moves(pos);
+              if (!moves.size())
+              {
+                  result = pos.checkers() ? pos.checkmate_value() : pos.stalemate_value();
+                  break;
+              }
+              m = *(moves.begin() + rng.rand<unsigned>() % moves.size());
+          }
+          else
+          {
+              th.batch_search();
+              if (th.rootMoves.empty())
+              {
+                  result = pos.checkers() ? pos.checkmate_value() : pos.stalemate_value();
+                  break;
+              }
+
+              Value score = th.rootMoves[0].score;
+              m = th.rootMoves[0].pv[0];
+
+              // Adjudicate clearly decided games
+              if (abs(score) >= evalLimit)
+              {
+                  result = score > 0 ? VALUE_MATE : -VALUE_MATE;
+                  break;
+              }
+
+              game.push_back({ packed.size(), score, m, pos.side_to_move() });
+              packed.resize(packed.size() + packedSize);
+              pos.pack(&packed[game.back().offset]);
+          }
+
+          states->emplace_back();
+          pos.do_move(m, states->back());
+      }
+
+      Color stm = pos.side_to_move();
+      int whiteResult = (result > VALUE_DRAW) - (result < VALUE_DRAW);
+      if (stm == BLACK)
+          whiteResult = -whiteResult;
+
+      for (const Record& r : game)
+      {
+          buf.append(reinterpret_cast<const char*>(&packed[r.offset]), packedSize);
+          append_le(buf, int16_t(r.score));
+          append_move(buf, variant, r.move);
+          append_le(buf, int8_t(r.sideToMove == WHITE ? whiteResult : -whiteResult));
+      }
+
+      generated += game.size();
+
+      if (buf.size() >= BufferSize)
+      {
+          writer.push(std::move(buf));
+          buf.clear();
+      }
+  }
+
+  if (!buf.empty())
+      writer.push(std::move(buf));
+}
+
+} // namespace
+
+
+/// gensfen() is called when engine receives the "gensfen" command. Self-play
+/// games of the current variant are played on all threads and the searched
+/// positions are written to a binary training data file.
+///
+/// gensfen depth=8 count=1000000 out=training.bin random=8 eval_limit=3000 max_ply=400
+
+void gensfen(istream& is) {
+
+  Search::LimitsType limits;
+  string token, outFile = "training_data.bin";
+  const Variant* variant = variants.find(Options["UCI_Variant"])->second;
+  int64_t nodes = 0, count = 1000000;
+  int randomPlies = 8, maxPly = 400, evalLimit = 3000;
+
+  while (is >> token)
+  {
+      size_t eq = token.find('=');
+      string key = token.substr(0, eq), value = eq == string::npos ? "" : token.substr(eq + 1);
+
+      if (key == "out")             outFile = value;
+      else if (key == "depth")      limits.depth = atoi(value.c_str());
+      else if (key == "nodes")      nodes = atoll(value.c_str());
+      else if (key == "count")      count = atoll(value.c_str());
+      else if (key == "random")     randomPlies = atoi(value.c_str());
+      else if (key == "max_ply")    maxPly = atoi(value.c_str());
+      else if (key == "eval_limit") evalLimit = atoi(value.c_str());
+  }
+
+  if (!limits.depth && !nodes)
+      limits.depth = 8;
+
+  AsyncWriter writer(outFile);
+  if (!writer.is_open())
+  {
+      sync_cout << "info string Unable to open file " << outFile << sync_endl;
+      return;
+  }
+
+  string header(FileMagic, sizeof(FileMagic));
+  string name = Options["UCI_Variant"];
+  append_le(header, FileVersion);
+  append_le(header, uint32_t(variant->nnueDimensions));
+  append_le(header, uint32_t(Position::packed_size(variant)));
+  append_le(header, uint32_t(variant->maxFile + 1));
+  append_le(header, uint32_t(variant->maxRank + 1));
+  append_le(header, uint32_t(name.size()));
+  header += name;
+  writer.push(std::move(header));
+
+  TrainingDataGenerator generator(variant, Options["UCI_Chess960"], writer);
+  generator.nodes = nodes;
+  generator.count = uint64_t(count);
+  generator.randomPlies = randomPlies;
+  generator.maxPly = maxPly;
+  generator.evalLimit = Value(evalLimit * PawnValueEg / 100);
+
+  TimePoint elapsed = now();
+  Threads.run_batch(generator, limits);
+  elapsed = now() - elapsed + 1;
+
+  sync_cout << "info string generated " << generator.generated << " positions in " << elapsed << " ms" << sync_endl;
+}
+
+} // namespace Stockfish
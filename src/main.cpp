@@ -35,7 +35,12 @@
 
 using namespace Stockfish;
 
+// In a fat binary, main() of fat.cpp selects a build and calls its entry point
+#ifdef FAT_ENTRY
+extern "C" int FAT_ENTRY(int argc, char* argv[]) {
+#else
 int main(int argc, char* argv[]) {
+#endif
 
   std::cout << engine_info() << std::endl;
 
@@ -39,9 +39,13 @@ typedef bool(*fun3_t)(HANDLE, CONST GROUP_AFFINITY*, PGROUP_AFFINITY);
 }
 #endif
 
+#include <cinttypes>
+#include <cstdio>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <map>
+#include <mutex>
 #include <sstream>
 #include <vector>
 #include <cstdlib>
@@ -269,6 +273,9 @@ std::string compiler_info() {
   #if !defined(NDEBUG)
     compiler += " DEBUG";
   #endif
+  #if defined(FAT_ENTRY)
+    compiler += " (selected at startup)";
+  #endif
 
   compiler += "\n__VERSION__ macro expands to: ";
   #ifdef __VERSION__
@@ -318,6 +325,93 @@ std::ostream& operator<<(std::ostream& os, SyncCout sc) {
 }
 
 
+namespace {
+
+/// OutputQueue is a lock-free single producer, single consumer ring buffer of
+/// lines, drained by a dedicated output thread. The consumer frees a slot before
+/// writing its line, and counts the lines written separately for flushing.
+
+class OutputQueue {
+
+  static constexpr size_t Size = 256; // Power of two
+
+public:
+  OutputQueue() : writer(&OutputQueue::idle_loop, this) {}
+ ~OutputQueue() {
+    exit = true;
+    cv.notify_one();
+    writer.join();
+  }
+
+  bool push(std::string&& line) {
+    size_t h = head.load(std::memory_order_relaxed);
+    if (h - tail.load(std::memory_order_acquire) == Size)
+        return false;
+
+    slots[h & (Size - 1)] = std::move(line);
+    head.store(h + 1, std::memory_order_release);
+    cv.notify_one();
+    return true;
+  }
+
+  void flush() const {
+    while (written.load(std::memory_order_acquire) != head.load(std::memory_order_relaxed))
+        std::this_thread::yield();
+  }
+
+private:
+  void idle_loop() {
+    while (true)
+    {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t == head.load(std::memory_order_acquire))
+        {
+            if (exit)
+                return;
+
+            // The producer notifies without holding the mutex, so a wakeup may
+            // be missed in rare cases. Waiting with a timeout bounds the delay.
+            std::unique_lock<std::mutex> lk(mutex);
+            cv.wait_for(lk, std::chrono::milliseconds(10));
+            continue;
+        }
+
+        std::string line = std::move(slots[t & (Size - 1)]);
+        tail.store(t + 1, std::memory_order_release);
+        sync_cout << line << sync_endl;
+        written.store(t + 1, std::memory_order_release);
+    }
+  }
+
+  std::string slots[Size];
+  std::atomic<size_t> head{0}, tail{0}, written{0};
+  std::atomic_bool exit{false};
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::thread writer;
+};
+
+OutputQueue& output_queue() {
+  static OutputQueue queue; // Started on first use
+  return queue;
+}
+
+} // namespace
+
+bool sync_post(std::string&& line, bool important) {
+
+  while (!output_queue().push(std::move(line)))
+  {
+      if (!important)
+          return false;
+      std::this_thread::yield();
+  }
+  return true;
+}
+
+void sync_flush() { output_queue().flush(); }
+
+
 /// Trampoline helper to avoid moving Logger to misc.h
 void start_logger(const std::string& fname) { Logger::start(fname); }
 
@@ -376,6 +470,57 @@ void std_aligned_free(void* ptr) {
 #endif
 }
 
+namespace {
+
+/// Large pages are used for the big tables of the engine according to the
+/// "Large Pages" option. Every allocation is kept track of, so that it can be
+/// freed the way it was allocated and be reported with its actual backing.
+
+enum LargePageMode { LP_AUTO, LP_RESERVED, LP_OFF };
+
+struct LargePageBlock {
+  size_t size;
+  size_t pageSize; // Size of the reserved large pages, or 0 if none
+  const char* owner;
+};
+
+struct LargePageBlocks {
+  std::mutex mutex;
+  std::map<void*, LargePageBlock> blocks;
+};
+
+LargePageMode largePageMode = LP_AUTO;
+
+// Never destroyed, as global tables may be freed during static destruction
+LargePageBlocks& large_page_blocks() {
+  static LargePageBlocks* lpb = new LargePageBlocks;
+  return *lpb;
+}
+
+void* register_block(void* mem, size_t size, size_t pageSize, const char* owner) {
+
+  if (mem)
+  {
+      LargePageBlocks& lpb = large_page_blocks();
+      std::lock_guard<std::mutex> lk(lpb.mutex);
+      lpb.blocks[mem] = { size, pageSize, owner };
+  }
+  return mem;
+}
+
+} // namespace
+
+
+/// set_large_pages() sets the mode of later large page allocations: "Auto" uses
+/// large pages as the platform does by default, "Reserved" additionally tries the
+/// explicitly reserved huge pages of hugetlbfs on Linux and "Off" disables them.
+
+void set_large_pages(const string& mode) {
+
+  largePageMode = mode == "Reserved" ? LP_RESERVED : mode == "Off" ? LP_OFF : LP_AUTO;
+}
+
+
 /// aligned_large_pages_alloc() will return suitably aligned memory, if possible using large pages.
 
 #if defined(_WIN32)
@@ -390,8 +535,9 @@ static void* aligned_large_pages_alloc_windows(size_t allocSize) {
   LUID luid { };
   void* mem = nullptr;
 
+  // Smaller allocations would waste most of the page
   const size_t largePageSize = GetLargePageMinimum();
-  if (!largePageSize)
+  if (!largePageSize || allocSize < largePageSize)
       return nullptr;
 
   // We need SeLockMemoryPrivilege, so try to enable it for the process
@@ -431,24 +577,68 @@ static void* aligned_large_pages_alloc_windows(size_t allocSize) {
   #endif
 }
 
-void* aligned_large_pages_alloc(size_t allocSize) {
+void* aligned_large_pages_alloc(size_t allocSize, const char* owner) {
 
   // Try to allocate large pages
-  void* mem = aligned_large_pages_alloc_windows(allocSize);
+  void* mem = largePageMode != LP_OFF ? aligned_large_pages_alloc_windows(allocSize) : nullptr;
+  if (mem)
+      return register_block(mem, allocSize, GetLargePageMinimum(), owner);
 
   // Fall back to regular, page aligned, allocation if necessary
-  if (!mem)
-      mem = VirtualAlloc(NULL, allocSize, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
-
-  return mem;
+  mem = VirtualAlloc(NULL, allocSize, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+  return register_block(mem, allocSize, 0, owner);
 }
 
 #else
 
-void* aligned_large_pages_alloc(size_t allocSize) {
+#if defined(__linux__) && defined(MAP_HUGETLB)
+
+/// aligned_hugetlb_alloc() maps explicitly reserved huge pages, trying 1GB pages
+/// first and 2MB pages next. Only allocations spanning at least a full page are
+/// placed there, as the rest of the page would be wasted. The size is rounded up
+/// to full pages. Huge pages need to be reserved first, e.g. with
+/// "echo 512 > /proc/sys/vm/nr_hugepages" for 1GB of 2MB pages.
+
+static void* aligned_hugetlb_alloc(size_t& size, size_t& pageSize) {
+
+  constexpr int HugeShift = 26; // MAP_HUGE_SHIFT, the page size is encoded as its log2
+
+  for (int log2Page : { 30, 21 })
+  {
+      pageSize = size_t(1) << log2Page;
+      if (size < pageSize)
+          continue;
+
+      size_t pagesSize = (size + pageSize - 1) & ~(pageSize - 1);
+      void* mem = mmap(nullptr, pagesSize, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | (log2Page << HugeShift), -1, 0);
+      if (mem != MAP_FAILED)
+      {
+          size = pagesSize;
+          return mem;
+      }
+  }
+  return nullptr;
+}
+
+#endif
+
+void* aligned_large_pages_alloc(size_t allocSize, const char* owner) {
+
+#if defined(__linux__) && defined(MAP_HUGETLB)
+  if (largePageMode == LP_RESERVED)
+  {
+      size_t size = allocSize, pageSize;
+      if (void* mem = aligned_hugetlb_alloc(size, pageSize))
+          return register_block(mem, size, pageSize, owner);
+  }
+#endif
 
 #if defined(__linux__)
-  constexpr size_t alignment = 2 * 1024 * 1024; // assumed 2MB page size
+  // Like reserved huge pages, transparent huge pages are only used for
+  // allocations spanning at least a full page
+  const bool largePages = largePageMode != LP_OFF && allocSize >= LargePageSize;
+  const size_t alignment = largePages ? LargePageSize : 4096;
 #else
   constexpr size_t alignment = 4096; // assumed small page size
 #endif
@@ -456,10 +646,11 @@ void* aligned_large_pages_alloc(size_t allocSize) {
   // round up to multiples of alignment
   size_t size = ((allocSize + alignment - 1) / alignment) * alignment;
   void *mem = std_aligned_alloc(alignment, size);
-#if defined(MADV_HUGEPAGE)
-  madvise(mem, size, MADV_HUGEPAGE);
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+  if (mem && largePages)
+      madvise(mem, size, MADV_HUGEPAGE);
 #endif
-  return mem;
+  return register_block(mem, size, 0, owner);
 }
 
 #endif
@@ -471,7 +662,16 @@ void* aligned_large_pages_alloc(size_t allocSize) {
 
 void aligned_large_pages_free(void* mem) {
 
-  if (mem && !VirtualFree(mem, 0, MEM_RELEASE))
+  if (!mem)
+      return;
+
+  {
+      LargePageBlocks& lpb = large_page_blocks();
+      std::lock_guard<std::mutex> lk(lpb.mutex);
+      lpb.blocks.erase(mem);
+  }
+
+  if (!VirtualFree(mem, 0, MEM_RELEASE))
   {
       DWORD err = GetLastError();
       std::cerr << "Failed to free large page memory. Error code: 0x"
@@ -484,12 +684,106 @@ void aligned_large_pages_free(void* mem) {
 #else
 
 void aligned_large_pages_free(void *mem) {
+
+  if (!mem)
+      return;
+
+  LargePageBlock block = {};
+  {
+      LargePageBlocks& lpb = large_page_blocks();
+      std::lock_guard<std::mutex> lk(lpb.mutex);
+      auto it = lpb.blocks.find(mem);
+      if (it != lpb.blocks.end())
+      {
+          block = it->second;
+          lpb.blocks.erase(it);
+      }
+  }
+
+#if defined(__linux__) && defined(MAP_HUGETLB)
+  if (block.pageSize)
+  {
+      munmap(mem, block.size);
+      return;
+  }
+#endif
+
   std_aligned_free(mem);
 }
 
 #endif
 
 
+/// large_pages_info() reports for every owner of large page allocations how
+/// much of its memory is actually backed by large pages. On Linux, transparent
+/// huge pages are looked up in /proc/self/smaps, as the kernel may or may not
+/// have been able to provide them.
+
+string large_pages_info() {
+
+  struct Usage { size_t size = 0, transparent = 0; map<size_t, size_t> reserved; };
+  map<string, Usage> usage;
+
+#if defined(__linux__)
+  struct Mapping { uintptr_t begin, end; size_t hugeBytes; };
+  vector<Mapping> mappings;
+  ifstream smaps("/proc/self/smaps");
+  string line;
+
+  while (getline(smaps, line))
+  {
+      uintptr_t begin, end;
+      size_t kB;
+      if (sscanf(line.c_str(), "%" SCNxPTR "-%" SCNxPTR, &begin, &end) == 2 && line.find(' ') > line.find('-'))
+          mappings.push_back({ begin, end, 0 });
+      else if (!mappings.empty() && sscanf(line.c_str(), "AnonHugePages: %zu kB", &kB) == 1)
+          mappings.back().hugeBytes = kB * 1024;
+  }
+#endif
+
+  {
+      LargePageBlocks& lpb = large_page_blocks();
+      std::lock_guard<std::mutex> lk(lpb.mutex);
+      for (const auto& b : lpb.blocks)
+      {
+          Usage& u = usage[b.second.owner];
+          u.size += b.second.size;
+          if (b.second.pageSize)
+              u.reserved[b.second.pageSize] += b.second.size;
+#if defined(__linux__)
+          else
+          {
+              uintptr_t begin = uintptr_t(b.first), end = begin + b.second.size;
+              for (const Mapping& m : mappings)
+                  if (m.begin < end && begin < m.end)
+                      u.transparent += std::min(m.hugeBytes, std::min(end, m.end) - std::max(begin, m.begin));
+          }
+#endif
+      }
+  }
+
+  auto mb = [](size_t bytes) {
+      stringstream ss;
+      ss << std::fixed << std::setprecision(1) << double(bytes) / (1024 * 1024) << " MB";
+      return ss.str();
+  };
+
+  stringstream ss;
+  ss << "Large pages:";
+  for (const auto& u : usage)
+  {
+      ss << " " << u.first << " " << mb(u.second.size) << " (";
+      bool any = false;
+      for (auto it = u.second.reserved.rbegin(); it != u.second.reserved.rend(); ++it, any = true)
+          ss << (any ? ", " : "") << mb(it->second) << " in " << (it->first >> 20) << " MB pages";
+      if (u.second.transparent)
+          ss << (any ? ", " : "") << mb(u.second.transparent) << " transparent", any = true;
+      ss << (any ? ")" : "no large pages)");
+  }
+  return ss.str();
+}
+
+
 namespace WinProcGroup {
 
 #ifndef _WIN32
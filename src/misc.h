@@ -21,6 +21,9 @@
 
 #include <cassert>
 #include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
 #include <ostream>
 #include <string>
 #include <vector>
@@ -36,8 +39,12 @@ void prefetch(void* addr);
 void start_logger(const std::string& fname);
 void* std_aligned_alloc(size_t alignment, size_t size);
 void std_aligned_free(void* ptr);
-void* aligned_large_pages_alloc(size_t size); // memory aligned by page size, min alignment: 4096 bytes
+void* aligned_large_pages_alloc(size_t size, const char* owner = "Other"); // memory aligned by page size, min alignment: 4096 bytes
 void aligned_large_pages_free(void* mem); // nop if mem == nullptr
+void set_large_pages(const std::string& mode);
+std::string large_pages_info();
+
+constexpr size_t LargePageSize = 2 * 1024 * 1024; // assumed large page size, smaller allocations do not use them
 
 void dbg_hit_on(bool b);
 void dbg_hit_on(bool c, bool b);
@@ -51,12 +58,65 @@ inline TimePoint now() {
         (std::chrono::steady_clock::now().time_since_epoch()).count();
 }
 
-template<class Entry, int Size>
+/// HashTable is a per-thread cache of evaluation terms. Its number of entries
+/// is a power of two, DefaultSize until resized. The entries are only allocated
+/// on the first probe, so that tables a variant never probes take no memory,
+/// and only tables of at least a large page are placed in large pages.
+
+template<class Entry, int DefaultSize>
 struct HashTable {
-  Entry* operator[](Key key) { return &table[(uint32_t)key & (Size - 1)]; }
+  HashTable() = default;
+ ~HashTable() { release(); }
+  HashTable(const HashTable&) = delete;
+  HashTable& operator=(const HashTable&) = delete;
+
+  Entry* operator[](Key key) {
+    if (!table)
+        allocate();
+    return &table[(uint32_t)key & (size - 1)];
+  }
+
+  // Rounds down to a power of two, the entries are lost if the size changes
+  void resize(size_t entries) {
+    size_t n = 1;
+    while (n <= entries / 2 && n < (size_t(1) << 30))
+        n *= 2;
+    if (n != size)
+        release(), size = n;
+  }
+
+  size_t entries() const { return size; }
+
+  uint64_t probes = 0, hits = 0;
 
 private:
-  std::vector<Entry> table = std::vector<Entry>(Size); // Allocate on the heap
+  bool large() const { return size * sizeof(Entry) >= LargePageSize; }
+
+  void allocate() {
+    table = static_cast<Entry*>(large() ? aligned_large_pages_alloc(size * sizeof(Entry), "Eval tables")
+                                        : std_aligned_alloc(64, size * sizeof(Entry)));
+    if (!table)
+    {
+        std::cerr << "Failed to allocate " << size * sizeof(Entry) << " bytes for eval tables." << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+    std::uninitialized_value_construct_n(table, size);
+  }
+
+  void release() {
+    if (table)
+    {
+        std::destroy_n(table, size);
+        if (large())
+            aligned_large_pages_free(table);
+        else
+            std_aligned_free(table);
+        table = nullptr;
+    }
+  }
+
+  Entry* table = nullptr;
+  size_t size = DefaultSize;
 };
 
 
@@ -66,6 +126,13 @@ std::ostream& operator<<(std::ostream&, SyncCout);
 #define sync_cout std::cout << IO_LOCK
 #define sync_endl std::endl << IO_UNLOCK
 
+/// sync_post() hands a line over to the output thread, so that the caller never
+/// blocks on a slow reader of stdout. While the output queue is full, lines are
+/// dropped unless they are important, and false is returned. Only one thread at
+/// a time may post lines. sync_flush() waits until all posted lines are written.
+bool sync_post(std::string&& line, bool important = false);
+void sync_flush();
+
 
 // align_ptr_up() : get the first aligned element of an array.
 // ptr must point to an array of size at least `sizeof(T) * N + alignment` bytes,
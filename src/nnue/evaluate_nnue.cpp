@@ -58,7 +58,7 @@ namespace Stockfish::Eval::NNUE {
   void initialize(LargePagePtr<T>& pointer) {
 
     static_assert(alignof(T) <= 4096, "aligned_large_pages_alloc() may fail for such a big alignment requirement of T");
-    pointer.reset(reinterpret_cast<T*>(aligned_large_pages_alloc(sizeof(T))));
+    pointer.reset(reinterpret_cast<T*>(aligned_large_pages_alloc(sizeof(T), "NNUE")));
     std::memset(pointer.get(), 0, sizeof(T));
   }
 
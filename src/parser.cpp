@@ -160,6 +160,16 @@ void VariantParser<DoCheck>::parse_attribute(const std::string& key, PieceType&
     }
 }
 
+/// VariantParser::parse_board() only parses the board size on top of the given
+/// inherited one, and returns whether the board is supported by this build.
+
+template <bool DoCheck>
+bool VariantParser<DoCheck>::parse_board(Rank& maxRank, File& maxFile) {
+    parse_attribute("maxRank", maxRank);
+    parse_attribute("maxFile", maxFile);
+    return maxFile <= FILE_MAX && maxRank <= RANK_MAX;
+}
+
 template <bool DoCheck>
 Variant* VariantParser<DoCheck>::parse() {
     Variant* v = new Variant();
@@ -377,6 +387,7 @@ Variant* VariantParser<DoCheck>::parse(Variant* v) {
     parse_attribute("connectN", v->connectN);
     parse_attribute("materialCounting", v->materialCounting);
     parse_attribute("countingRule", v->countingRule);
+    parse_attribute("evalCache", v->evalCache);
 
     // Report invalid options
     if (DoCheck)
@@ -464,5 +475,7 @@ template Variant* VariantParser<true>::parse();
 template Variant* VariantParser<false>::parse();
 template Variant* VariantParser<true>::parse(Variant* v);
 template Variant* VariantParser<false>::parse(Variant* v);
+template bool VariantParser<true>::parse_board(Rank& maxRank, File& maxFile);
+template bool VariantParser<false>::parse_board(Rank& maxRank, File& maxFile);
 
 } // namespace Stockfish
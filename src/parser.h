@@ -47,6 +47,7 @@ public:
     VariantParser(const Config& c) : config (c) {};
     Variant* parse();
     Variant* parse(Variant* v);
+    bool parse_board(Rank& maxRank, File& maxFile);
 
 private:
     Config config;
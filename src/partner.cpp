@@ -16,10 +16,13 @@
   along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <algorithm>
 #include <iostream>
 #include <sstream>
 #include <string>
 
+#include "fen.h"
+#include "movegen.h"
 #include "partner.h"
 #include "thread.h"
 #include "uci.h"
@@ -31,6 +34,8 @@ PartnerHandler Partner; // Global object
 void PartnerHandler::reset() {
     fast = sitRequested = partnerDead = weDead = weWin = weVirtualWin = weVirtualLoss = false;
     time = opptime = 0;
+    boardKnown = false;
+    incoming[WHITE] = incoming[BLACK] = 0;
 }
 
 template <PartnerType p>
@@ -61,7 +66,7 @@ void PartnerHandler::parse_ptell(std::istringstream& is, const Position& pos) {
     {
         if (!(is >> token))
         {
-            ptell<HUMAN>("I listen to the commands help, sit, go, move, fast, slow, dead, x, time, and otim.");
+            ptell<HUMAN>("I listen to the commands help, sit, go, move, fast, slow, dead, x, time, otim, board, and pmove.");
             ptell<HUMAN>("Tell 'help sit', etc. for details.");
         }
         else if (token == "sit")
@@ -88,6 +93,10 @@ void PartnerHandler::parse_ptell(std::istringstream& is, const Position& pos) {
         }
         else if (token == "otim")
             ptell<HUMAN>("'otim' together with your opponent's time in centiseconds allows me to consider his time.");
+        else if (token == "board")
+            ptell<HUMAN>("'board' together with the FEN of your board allows me to anticipate the pieces you pass me.");
+        else if (token == "pmove")
+            ptell<HUMAN>("'pmove' together with a move played on your board, e.g., 'pmove e7e5', updates your board.");
     }
     else if (!pos.two_boards())
         return;
@@ -149,6 +158,75 @@ void PartnerHandler::parse_ptell(std::istringstream& is, const Position& pos) {
         int value;
         opptime = (is >> value) ? value * 10 : 0;
     }
+    else if (token == "board")
+    {
+        std::string fen;
+        std::getline(is >> std::ws, fen);
+        if (FEN::check_fen(fen, pos.variant(), pos.is_chess960()) != FEN::FEN_OK)
+            return;
+        boardStates = StateListPtr(new std::deque<StateInfo>(1));
+        board.set(pos.variant(), fen, pos.is_chess960(), &boardStates->back(), nullptr);
+        boardKnown = true;
+        predict();
+    }
+    else if (token == "pmove")
+    {
+        Move move;
+        if (boardKnown && is >> token && (move = UCI::to_move(board, token)) != MOVE_NONE)
+        {
+            boardStates->emplace_back();
+            board.do_move(move, boardStates->back());
+            predict();
+        }
+    }
+}
+
+/// PartnerHandler::send_board() tells a Fairy-Stockfish partner our board
+/// after every move, so that it can anticipate the pieces we pass.
+
+void PartnerHandler::send_board(const Position& pos) {
+    if (pos.two_boards())
+        ptell<FAIRY>("board " + pos.fen());
+}
+
+/// PartnerHandler::predict() looks for the captures on the partner board that
+/// do not lose material according to the static exchange evaluation. The side
+/// to move there is likely to play one of them soon, passing the captured piece
+/// to the player of its color on our board.
+
+void PartnerHandler::predict() {
+    uint64_t expected = 0;
+    for (const auto& m : MoveList<CAPTURES>(board))
+        if (board.legal(m) && board.see_ge(m))
+        {
+            Square to = to_sq(m);
+            PieceType pt =  type_of(m) == EN_PASSANT           ? PAWN
+                          : board.unpromoted_piece_on(to)      ? type_of(board.unpromoted_piece_on(to))
+                                                               : type_of(board.piece_on(to));
+            expected |= uint64_t(1) << pt;
+        }
+    incoming[~board.side_to_move()] = expected;
+    incoming[board.side_to_move()] = 0;
+}
+
+/// PartnerHandler::expect_drop() checks whether a piece not yet in hand is
+/// expected from the partner board. Without a model of the partner board every
+/// piece is considered.
+
+bool PartnerHandler::expect_drop(Color c, PieceType pt) const {
+    return !boardKnown || (incoming[c] & (uint64_t(1) << pt));
+}
+
+/// PartnerHandler::expected_value() returns the value of the most valuable
+/// piece expected to be passed to a color, or zero if none is expected.
+
+Value PartnerHandler::expected_value(Color c) const {
+    Value v = VALUE_ZERO;
+    if (boardKnown)
+        for (int pt = NO_PIECE_TYPE; pt < PIECE_TYPE_NB; ++pt)
+            if (incoming[c] & (uint64_t(1) << pt))
+                v = std::max(v, PieceValue[MG][pt]);
+    return v;
 }
 
 template void PartnerHandler::ptell<HUMAN>(const std::string&);
@@ -42,11 +42,24 @@ struct PartnerHandler {
     void ptell(const std::string& message);
     void parse_partner(std::istringstream& is);
     void parse_ptell(std::istringstream& is, const Position& pos);
+    void send_board(const Position& pos);
+    bool expect_drop(Color c, PieceType pt) const;
+    Value expected_value(Color c) const;
 
     std::atomic<bool> isFairy;
     std::atomic<bool> fast, sitRequested, partnerDead, weDead, weWin, weVirtualWin, weVirtualLoss;
     std::atomic<TimePoint> time, opptime;
     Move moveRequested;
+
+    // Model of the partner board as told by the partner, with the piece types
+    // expected to be passed to each color from the captures available there.
+    Position board;
+    StateListPtr boardStates;
+    std::atomic<bool> boardKnown;
+    std::atomic<uint64_t> incoming[COLOR_NB];
+
+private:
+    void predict();
 };
 
 extern PartnerHandler Partner;
@@ -222,10 +222,16 @@ namespace Pawns {
 Entry* probe(const Position& pos) {
 
   Key key = pos.pawn_key();
-  Entry* e = pos.this_thread()->pawnsTable[key];
+  Thread* th = pos.this_thread();
+  Table& table = th->pawnsTable;
+  Entry* e = th->pawnless ? &th->pawnlessEntry : table[key];
 
+  ++table.probes;
   if (e->key == key && !pos.pieces(SHOGI_PAWN))
+  {
+      ++table.hits;
       return e;
+  }
 
   e->key = key;
   e->blockedCount = 0;
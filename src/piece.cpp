@@ -181,6 +181,7 @@ namespace {
 
 void PieceMap::init(const Variant* v) {
   clear_all();
+  variantId = v ? v->id : 0;
   add(PAWN, from_betza("fmWfceF", "pawn"));
   add(KNIGHT, from_betza("N", "knight"));
   add(BISHOP, from_betza("B", "bishop"));
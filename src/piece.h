@@ -43,6 +43,8 @@ struct PieceMap : public std::map<PieceType, const PieceInfo*> {
   void init(const Variant* v = nullptr);
   void add(PieceType pt, const PieceInfo* v);
   void clear_all();
+
+  size_t variantId = 0; // Of the variant the custom pieces are defined by
 };
 
 extern PieceMap pieceMap;
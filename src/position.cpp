@@ -636,6 +636,23 @@ Position& Position::set(const string& code, Color c, StateInfo* si) {
 }
 
 
+/// Position::set() is an overload to initialize the position object as a copy
+/// of the given position, avoiding the round trip through a FEN string. The
+/// current state is copied to si, the previous states are shared.
+
+Position& Position::set(const Position& pos, StateInfo* si, Thread* th) {
+
+  std::memcpy(static_cast<void*>(this), &pos, sizeof(Position));
+  *si = *pos.st;
+  st = si;
+  thisThread = th;
+
+  assert(pos_is_ok());
+
+  return *this;
+}
+
+
 /// Position::fen() returns a FEN representation of the position. In case of
 /// Chess960 the Shredder-FEN notation is used. This is mainly a debugging function.
 
@@ -773,6 +790,258 @@ string Position::fen(bool sfen, bool showPromoted, int countStarted, std::string
 }
 
 
+namespace {
+
+// Field widths of the packed position format
+constexpr int HandBits = 6, CastlingBits = 4, FileBits = 4, SquareBits = 7, CheckBits = 4, CountingBits = 8, Rule50Bits = 10, PlyBits = 16;
+
+// Little endian bit stream over a zero-initialized buffer
+struct BitWriter {
+  uint8_t* data;
+  size_t pos = 0;
+
+  void write(unsigned value, int bits) {
+    for (int i = 0; i < bits; ++i, ++pos)
+        if ((value >> i) & 1)
+            data[pos / 8] |= uint8_t(1 << (pos % 8));
+  }
+};
+
+struct BitReader {
+  const uint8_t* data;
+  size_t pos = 0;
+
+  unsigned read(int bits) {
+    unsigned value = 0;
+    for (int i = 0; i < bits; ++i, ++pos)
+        value |= unsigned((data[pos / 8] >> (pos % 8)) & 1) << i;
+    return value;
+  }
+};
+
+bool packs_hands(const Variant* v) {
+  return !v->freeDrops && (v->pieceDrops || v->seirawanGating || v->arrowGating);
+}
+
+bool packs_promoted(const Variant* v) {
+  return v->capturesToHand || v->twoBoards;
+}
+
+} // namespace
+
+
+/// Position::packed_size() returns the number of bytes of the packed encoding
+/// of positions of the given variant. The encoding has a fixed size per variant
+/// and only contains the fields relevant for its rules, in the order
+///
+/// side to move, board, promoted pieces, pieces in hand, castling rights,
+/// gates, en passant square, remaining checks, counting, rule50, game ply
+
+size_t Position::packed_size(const Variant* v) {
+
+  size_t squares = size_t(v->maxRank + 1) * (v->maxFile + 1);
+  size_t bits =  1 + squares * v->packedPieceBits
+               + (packs_promoted(v) ? squares : 0)
+               + (packs_hands(v) ? 2 * v->pieceTypes.size() * HandBits : 0)
+               + (v->castling ? CastlingBits + 6 * FileBits : 0)
+               + (v->gating ? 2 * (v->maxFile + 1) : 0)
+               + SquareBits
+               + (v->checkCounting ? 2 * CheckBits : 0)
+               + (v->countingRule ? 2 * CountingBits : 0)
+               + Rule50Bits + PlyBits;
+  return (bits + 7) / 8;
+}
+
+
+/// Position::pack() writes the packed encoding of the position to the given
+/// buffer, which needs to hold packed_size() bytes. Counters exceeding their
+/// field width are saturated.
+
+void Position::pack(uint8_t* data) const {
+
+  std::memset(data, 0, packed_size(var));
+  BitWriter bw{data};
+
+  bw.write(sideToMove, 1);
+
+  for (Rank r = RANK_1; r <= max_rank(); ++r)
+      for (File f = FILE_A; f <= max_file(); ++f)
+      {
+          Square s = make_square(f, r);
+          Piece pc = piece_on(s);
+          int idx = unpromoted_piece_on(s) ? var->packedPromotedIndex[type_of(unpromoted_piece_on(s))]
+                                           : var->packedPieceIndex[type_of(pc)];
+          bw.write(pc ? 1 + 2 * idx + color_of(pc) : 0, var->packedPieceBits);
+      }
+
+  if (packs_promoted(var))
+      for (Rank r = RANK_1; r <= max_rank(); ++r)
+          for (File f = FILE_A; f <= max_file(); ++f)
+              bw.write(is_promoted(make_square(f, r)), 1);
+
+  if (packs_hands(var))
+      for (Color c : {WHITE, BLACK})
+          for (PieceType pt : var->pieceTypes)
+              bw.write(std::min(pieceCountInHand[c][pt], (1 << HandBits) - 1), HandBits);
+
+  if (var->castling)
+  {
+      bw.write(st->castlingRights, CastlingBits);
+      for (Color c : {WHITE, BLACK})
+          bw.write(st->castlingKingSquare[c] == SQ_NONE ? 0 : file_of(st->castlingKingSquare[c]) + 1, FileBits);
+      for (CastlingRights cr : {WHITE_OO, WHITE_OOO, BLACK_OO, BLACK_OOO})
+          bw.write(can_castle(cr) ? file_of(castling_rook_square(cr)) : 0, FileBits);
+  }
+
+  if (var->gating)
+      for (Color c : {WHITE, BLACK})
+          for (File f = FILE_A; f <= max_file(); ++f)
+              bw.write(bool(gates(c) & make_square(f, castling_rank(c))), 1);
+
+  bw.write(ep_square() == SQ_NONE ? 0 : 1 + rank_of(ep_square()) * files() + file_of(ep_square()), SquareBits);
+
+  if (var->checkCounting)
+      for (Color c : {WHITE, BLACK})
+          bw.write(st->checksRemaining[c], CheckBits);
+
+  if (var->countingRule)
+  {
+      bw.write(std::min(st->countingLimit, (1 << CountingBits) - 1), CountingBits);
+      bw.write(std::min(st->countingPly, (1 << CountingBits) - 1), CountingBits);
+  }
+
+  bw.write(std::min(st->rule50, (1 << Rule50Bits) - 1), Rule50Bits);
+  bw.write(std::min(gamePly, (1 << PlyBits) - 1), PlyBits);
+}
+
+
+/// Position::unpack() initializes the position object from its packed encoding.
+/// It is the counterpart of pack() and equivalent to set() with the FEN of the
+/// packed position, but avoids all the string parsing. Returns false if the data
+/// contains unknown pieces or squares off the board, or if the kings, the castling
+/// pieces, the gates or the en passant square do not match, the position is then
+/// unusable.
+
+bool Position::unpack(const Variant* v, const uint8_t* data, bool isChess960, StateInfo* si, Thread* th) {
+
+  std::memset(this, 0, sizeof(Position));
+  std::memset(si, 0, sizeof(StateInfo));
+  st = si;
+  var = v;
+
+  BitReader br{data};
+
+  sideToMove = Color(br.read(1));
+
+  for (Rank r = RANK_1; r <= max_rank(); ++r)
+      for (File f = FILE_A; f <= max_file(); ++f)
+          if (unsigned code = br.read(v->packedPieceBits))
+          {
+              Color c = Color((code - 1) & 1);
+              size_t idx = (code - 1) / 2;
+              if (idx >= v->packedPieceTypes.size())
+                  return false;
+              PieceType pt = v->packedPieceTypes[idx];
+              if (idx < v->pieceTypes.size())
+                  put_piece(make_piece(c, pt), make_square(f, r));
+              else
+                  put_piece(make_piece(c, v->promotedPieceType[pt]), make_square(f, r), true, make_piece(c, pt));
+          }
+
+  if (packs_promoted(v))
+      for (Rank r = RANK_1; r <= max_rank(); ++r)
+          for (File f = FILE_A; f <= max_file(); ++f)
+              if (br.read(1))
+                  promotedPieces |= make_square(f, r);
+
+  if (packs_hands(v))
+      for (Color c : {WHITE, BLACK})
+          for (PieceType pt : v->pieceTypes)
+              for (int n = br.read(HandBits); n > 0; --n)
+                  add_to_hand(make_piece(c, pt));
+
+  // Move generation relies on the kings of the variant, on the board or in hand
+  for (Color c : {WHITE, BLACK})
+      if (count_with_hand(c, KING) != v->startKings[c])
+          return false;
+
+  st->epSquare = SQ_NONE;
+  st->castlingKingSquare[WHITE] = st->castlingKingSquare[BLACK] = SQ_NONE;
+
+  if (v->castling)
+  {
+      int rights = br.read(CastlingBits);
+      for (Color c : {WHITE, BLACK})
+          if (unsigned f = br.read(FileBits))
+          {
+              if (File(f - 1) > max_file())
+                  return false;
+              st->castlingKingSquare[c] = make_square(File(f - 1), castling_rank(c));
+          }
+      for (CastlingRights cr : {WHITE_OO, WHITE_OOO, BLACK_OO, BLACK_OOO})
+      {
+          File f = File(br.read(FileBits));
+          if (!(rights & cr))
+              continue;
+          Color c = cr & WHITE_CASTLING ? WHITE : BLACK;
+          Square kfrom = st->castlingKingSquare[c];
+          if (   f > max_file() || kfrom == SQ_NONE
+              || piece_on(kfrom) != make_piece(c, v->castlingKingPiece)
+              || piece_on(make_square(f, castling_rank(c))) != make_piece(c, v->castlingRookPiece)
+              || make_square(f, castling_rank(c)) == kfrom)
+              return false;
+          set_castling_right(c, make_square(f, castling_rank(c)));
+      }
+  }
+
+  if (v->gating)
+      for (Color c : {WHITE, BLACK})
+          for (File f = FILE_A; f <= max_file(); ++f)
+              if (br.read(1))
+              {
+                  if (!(pieces(c) & make_square(f, castling_rank(c))))
+                      return false;
+                  st->gatesBB[c] |= make_square(f, castling_rank(c));
+              }
+
+  if (unsigned ep = br.read(SquareBits))
+  {
+      if (ep > unsigned(files() * ranks()))
+          return false;
+      st->epSquare = make_square(File((ep - 1) % files()), Rank((ep - 1) / files()));
+      // Same conditions as for the en passant square of a FEN, see set()
+      if (   relative_rank(sideToMove, st->epSquare, max_rank()) == RANK_1
+          || relative_rank(sideToMove, st->epSquare, max_rank()) == max_rank()
+          || !(pawn_attacks_bb(~sideToMove, st->epSquare) & pieces(sideToMove, PAWN))
+          || !(pieces(~sideToMove, PAWN) & (st->epSquare + pawn_push(~sideToMove)))
+          || (pieces() & (st->epSquare | (st->epSquare + pawn_push(sideToMove)))))
+          return false;
+  }
+
+  if (v->checkCounting)
+      for (Color c : {WHITE, BLACK})
+          st->checksRemaining[c] = CheckCount(br.read(CheckBits));
+
+  if (v->countingRule)
+  {
+      st->countingLimit = br.read(CountingBits);
+      st->countingPly = br.read(CountingBits);
+  }
+
+  st->rule50 = br.read(Rule50Bits);
+  gamePly = br.read(PlyBits);
+
+  chess960 = isChess960 || v->chess960;
+  tsumeMode = Options["TsumeMode"];
+  thisThread = th;
+  set_state(st);
+
+  assert(pos_is_ok());
+
+  return true;
+}
+
+
 /// Position::slider_blockers() returns a bitboard of all the pieces (both colors)
 /// that are blocking attacks on the square 's' from 'sliders'. A piece blocks a
 /// slider if removing that piece from the board would result in a position where
@@ -1370,7 +1639,8 @@ void Position::do_move(Move m, StateInfo& newSt, bool givesCheck) {
   assert(&newSt != st);
 
 #ifndef NO_THREADS
-  thisThread->nodes.fetch_add(1, std::memory_order_relaxed);
+  if (thisThread) // Positions of API boards are not owned by a search thread
+      thisThread->nodes.fetch_add(1, std::memory_order_relaxed);
 #endif
   Key k = st->key ^ Zobrist::side;
 
@@ -1493,7 +1763,8 @@ void Position::do_move(Move m, StateInfo& newSt, bool givesCheck) {
       k ^= Zobrist::psq[captured][capsq];
       st->materialKey ^= Zobrist::psq[captured][pieceCount[captured]];
 #ifndef NO_THREADS
-      prefetch(thisThread->materialTable[st->materialKey]);
+      if (thisThread)
+          prefetch(thisThread->materialTable[st->materialKey]);
 #endif
       // Reset rule 50 counter
       st->rule50 = 0;
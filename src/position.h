@@ -36,6 +36,10 @@
 
 namespace Stockfish {
 
+namespace Zobrist {
+  extern Key side; // Also serves as a fingerprint of the hash key layout
+}
+
 /// StateInfo struct stores information needed to restore a Position object to
 /// its previous state when we retract a move. Whenever a move is made on the
 /// board (by calling Position::do_move), a StateInfo object must be passed.
@@ -110,8 +114,14 @@ public:
   // FEN string input/output
   Position& set(const Variant* v, const std::string& fenStr, bool isChess960, StateInfo* si, Thread* th, bool sfen = false);
   Position& set(const std::string& code, Color c, StateInfo* si);
+  Position& set(const Position& pos, StateInfo* si, Thread* th);
   std::string fen(bool sfen = false, bool showPromoted = false, int countStarted = 0, std::string holdings = "-") const;
 
+  // Packed binary input/output
+  static size_t packed_size(const Variant* v);
+  void pack(uint8_t* data) const;
+  bool unpack(const Variant* v, const uint8_t* data, bool isChess960, StateInfo* si, Thread* th);
+
   // Variant rule properties
   const Variant* variant() const;
   Rank max_rank() const;
@@ -9,6 +9,7 @@
 #include "misc.h"
 #include "types.h"
 #include "bitboard.h"
+#include "endgame.h"
 #include "evaluate.h"
 #include "position.h"
 #include "search.h"
@@ -22,6 +23,20 @@
 
 using namespace Stockfish;
 
+namespace Stockfish::UCI {
+    extern bool parse_limits(const Position& pos, std::istream& is, Search::LimitsType& limits);
+}
+
+// Builds for several architectures are submodules of the pyffish package named after them, see setup.py
+#ifndef PYFFISH_MODULE
+#define PYFFISH_MODULE pyffish
+#endif
+#ifndef PYFFISH_ARCH
+#define PYFFISH_ARCH "generic"
+#endif
+#define PYFFISH_INIT_FUNC(name) PyInit_##name
+#define PYFFISH_INIT(name) PYFFISH_INIT_FUNC(name)
+
 static PyObject* PyFFishError;
 
 void buildPosition(Position& pos, StateListPtr& states, const char *variant, const char *fen, PyObject *moveList, const bool chess960) {
@@ -231,6 +246,34 @@ extern "C" PyObject* pyffish_legalMoves(PyObject* self, PyObject *args) {
     return Result;
 }
 
+// INPUT variant, fen, move list
+extern "C" PyObject* pyffish_legalMovesSAN(PyObject* self, PyObject *args) {
+    PyObject* legalMoves = PyList_New(0), *moveList;
+    Position pos;
+    const char *fen, *variant;
+
+    int chess960 = false;
+    Notation notation = NOTATION_DEFAULT;
+    if (!PyArg_ParseTuple(args, "ssO!|pi", &variant, &fen, &PyList_Type, &moveList, &chess960, &notation)) {
+        return NULL;
+    }
+    if (notation == NOTATION_DEFAULT)
+        notation = default_notation(variants.find(std::string(variant))->second);
+    StateListPtr states(new std::deque<StateInfo>(1));
+    buildPosition(pos, states, variant, fen, moveList, chess960);
+    for (const std::string& san : SAN::all_moves_to_san(pos, MoveList<LEGAL>(pos), notation))
+    {
+        PyObject *moveStr;
+        moveStr = Py_BuildValue("s", san.c_str());
+        PyList_Append(legalMoves, moveStr);
+        Py_XDECREF(moveStr);
+    }
+
+    PyObject *Result = Py_BuildValue("O", legalMoves);
+    Py_XDECREF(legalMoves);
+    return Result;
+}
+
 // INPUT variant, fen, move list
 extern "C" PyObject* pyffish_getFEN(PyObject* self, PyObject *args) {
     PyObject *moveList;
@@ -351,6 +394,447 @@ extern "C" PyObject* pyffish_validateFen(PyObject* self, PyObject *args) {
     return Py_BuildValue("i", FEN::validate_fen(std::string(fen), variants.find(std::string(variant))->second, chess960));
 }
 
+// INPUT variant, fen, move list
+extern "C" PyObject* pyffish_getPacked(PyObject* self, PyObject *args) {
+    PyObject *moveList;
+    Position pos;
+    const char *fen, *variant;
+    int chess960 = false;
+    if (!PyArg_ParseTuple(args, "ssO!|p", &variant, &fen, &PyList_Type, &moveList, &chess960)) {
+        return NULL;
+    }
+
+    StateListPtr states(new std::deque<StateInfo>(1));
+    buildPosition(pos, states, variant, fen, moveList, chess960);
+    std::string data(Position::packed_size(pos.variant()), '\0');
+    pos.pack(reinterpret_cast<uint8_t*>(&data[0]));
+    return PyBytes_FromStringAndSize(data.data(), data.size());
+}
+
+// INPUT variant, packed position
+extern "C" PyObject* pyffish_unpackFen(PyObject* self, PyObject *args) {
+    Py_buffer data;
+    Position pos;
+    const char *variant;
+    int chess960 = false, sfen = false, showPromoted = false, countStarted = 0;
+    if (!PyArg_ParseTuple(args, "sy*|pppi", &variant, &data, &chess960, &sfen, &showPromoted, &countStarted)) {
+        return NULL;
+    }
+
+    const Variant* v = variants.find(std::string(variant))->second;
+    if (size_t(data.len) != Position::packed_size(v))
+    {
+        PyBuffer_Release(&data);
+        PyErr_SetString(PyExc_ValueError, "Invalid packed position size");
+        return NULL;
+    }
+
+    StateInfo st;
+    UCI::init_variant(v);
+    bool valid = pos.unpack(v, static_cast<const uint8_t*>(data.buf), chess960, &st, Threads.main());
+    PyBuffer_Release(&data);
+    if (!valid)
+    {
+        PyErr_SetString(PyExc_ValueError, "Invalid packed position");
+        return NULL;
+    }
+    return Py_BuildValue("s", pos.fen(sfen, showPromoted, countStarted).c_str());
+}
+
+// Wraps a new bytes object of the given size for the buffer protocol, e.g. for numpy.asarray
+PyObject* newArray(Py_ssize_t size, char*& data) {
+    PyObject *bytes = PyBytes_FromStringAndSize(NULL, size);
+    if (!bytes)
+        return NULL;
+    data = PyBytes_AS_STRING(bytes);
+    PyObject *view = PyMemoryView_FromObject(bytes);
+    Py_XDECREF(bytes);
+    return view;
+}
+
+// INPUT list of fens, variant
+extern "C" PyObject* pyffish_validateFens(PyObject* self, PyObject *args) {
+    PyObject *fenList;
+    const char *variant;
+    int chess960 = false;
+    if (!PyArg_ParseTuple(args, "O!s|p", &PyList_Type, &fenList, &variant, &chess960)) {
+        return NULL;
+    }
+
+    const FEN::FenValidator validator(variants.find(std::string(variant))->second, chess960);
+    Py_ssize_t size = PyList_Size(fenList);
+    char *data;
+    PyObject *view = newArray(size, data);
+    if (!view)
+        return NULL;
+    for (Py_ssize_t i = 0; i < size; ++i)
+    {
+        Py_ssize_t length;
+        const char *fen = PyUnicode_AsUTF8AndSize(PyList_GET_ITEM(fenList, i), &length);
+        if (!fen)
+        {
+            Py_XDECREF(view);
+            return NULL;
+        }
+        data[i] = int8_t(validator.validate(std::string_view(fen, length)));
+    }
+
+    PyObject *Result = PyObject_CallMethod(view, "cast", "s", "b");
+    Py_XDECREF(view);
+    return Result;
+}
+
+// INPUT variant, fen, move list
+extern "C" PyObject* pyffish_legalMovesArray(PyObject* self, PyObject *args) {
+    PyObject *moveList;
+    Position pos;
+    const char *fen, *variant;
+
+    int chess960 = false;
+    if (!PyArg_ParseTuple(args, "ssO!|p", &variant, &fen, &PyList_Type, &moveList, &chess960)) {
+        return NULL;
+    }
+
+    StateListPtr states(new std::deque<StateInfo>(1));
+    buildPosition(pos, states, variant, fen, moveList, chess960);
+    if (PyErr_Occurred())
+        return NULL;
+    MoveList<LEGAL> legalMoves(pos);
+    char *data;
+    PyObject *view = newArray(legalMoves.size() * sizeof(uint32_t), data);
+    if (!view)
+        return NULL;
+    uint32_t *moves = reinterpret_cast<uint32_t*>(data);
+    for (const auto& m : legalMoves)
+        *moves++ = uint32_t(Move(m));
+
+    PyObject *Result = PyObject_CallMethod(view, "cast", "s", "I");
+    Py_XDECREF(view);
+    return Result;
+}
+
+// INPUT variant, fen, move list
+extern "C" PyObject* pyffish_getPlanes(PyObject* self, PyObject *args) {
+    PyObject *moveList;
+    Position pos;
+    const char *fen, *variant;
+
+    int chess960 = false;
+    if (!PyArg_ParseTuple(args, "ssO!|p", &variant, &fen, &PyList_Type, &moveList, &chess960)) {
+        return NULL;
+    }
+
+    StateListPtr states(new std::deque<StateInfo>(1));
+    buildPosition(pos, states, variant, fen, moveList, chess960);
+    if (PyErr_Occurred())
+        return NULL;
+    const Variant* v = pos.variant();
+    size_t planes = plane_count(v), ranks = v->maxRank + 1, files = v->maxFile + 1;
+    char *data;
+    PyObject *view = newArray(planes * ranks * files, data);
+    if (!view)
+        return NULL;
+    board_planes(pos, reinterpret_cast<int8_t*>(data));
+
+    PyObject *Result = PyObject_CallMethod(view, "cast", "s(nnn)", "b", Py_ssize_t(planes), Py_ssize_t(ranks), Py_ssize_t(files));
+    Py_XDECREF(view);
+    return Result;
+}
+
+// INPUT variant
+extern "C" PyObject* pyffish_getPlanePieces(PyObject* self, PyObject *args) {
+    const char *variant;
+    if (!PyArg_ParseTuple(args, "s", &variant)) {
+        return NULL;
+    }
+
+    std::vector<std::string> pieces = plane_pieces(variants.find(std::string(variant))->second);
+    PyObject *Result = PyList_New(pieces.size());
+    for (size_t i = 0; i < pieces.size(); i++)
+        PyList_SET_ITEM(Result, i, Py_BuildValue("s", pieces[i].c_str()));
+    return Result;
+}
+
+// INPUT variant, packed move of legal_moves_array
+extern "C" PyObject* pyffish_decodeMove(PyObject* self, PyObject *args) {
+    const char *variant;
+    unsigned int move;
+    if (!PyArg_ParseTuple(args, "sI", &variant, &move)) {
+        return NULL;
+    }
+
+    DecodedMove m = decode_move(variants.find(std::string(variant))->second, Move(move));
+    return Py_BuildValue("(iisi)", m.from, m.to, m.type, m.piece);
+}
+
+// INPUT variant, fen, move list
+extern "C" PyObject* pyffish_replayGame(PyObject* self, PyObject *args) {
+    PyObject *moveList;
+    Position pos;
+    const char *fen, *variant;
+
+    int chess960 = false;
+    Notation notation = NOTATION_DEFAULT;
+    if (!PyArg_ParseTuple(args, "ssO!|pi", &variant, &fen, &PyList_Type, &moveList, &chess960, &notation)) {
+        return NULL;
+    }
+    if (notation == NOTATION_DEFAULT)
+        notation = default_notation(variants.find(std::string(variant))->second);
+
+    std::vector<std::string> moves;
+    int numMoves = PyList_Size(moveList);
+    for (int i = 0; i < numMoves; i++)
+    {
+        PyObject *MoveStr = PyUnicode_AsEncodedString(PyList_GetItem(moveList, i), "UTF-8", "strict");
+        if (!MoveStr)
+            return NULL;
+        moves.emplace_back(PyBytes_AS_STRING(MoveStr));
+        Py_XDECREF(MoveStr);
+    }
+
+    PyObject* emptyList = PyList_New(0);
+    StateListPtr states(new std::deque<StateInfo>(1));
+    buildPosition(pos, states, variant, fen, emptyList, chess960);
+    Py_XDECREF(emptyList);
+
+    GameReplay replay;
+    size_t plies = replay_game(pos, states, moves, notation, replay);
+    if (plies < moves.size())
+    {
+        PyErr_SetString(PyExc_ValueError, (std::string("Invalid move '") + moves[plies] + "'").c_str());
+        return NULL;
+    }
+
+    PyObject *fens = PyList_New(plies), *sans = PyList_New(plies), *checks = PyList_New(plies),
+             *gameEnds = PyList_New(plies), *results = PyList_New(plies);
+    for (size_t i = 0; i < plies; i++)
+    {
+        PyList_SET_ITEM(fens, i, Py_BuildValue("s", replay.fens[i].c_str()));
+        PyList_SET_ITEM(sans, i, Py_BuildValue("s", replay.sans[i].c_str()));
+        PyList_SET_ITEM(checks, i, PyBool_FromLong(replay.checks[i]));
+        PyList_SET_ITEM(gameEnds, i, PyBool_FromLong(replay.gameEnds[i]));
+        PyList_SET_ITEM(results, i, PyLong_FromLong(replay.results[i]));
+    }
+    PyObject *Result = Py_BuildValue("(OOOOO)", fens, sans, checks, gameEnds, results);
+    Py_XDECREF(fens);
+    Py_XDECREF(sans);
+    Py_XDECREF(checks);
+    Py_XDECREF(gameEnds);
+    Py_XDECREF(results);
+    return Result;
+}
+
+// INPUT variant, fen, move list, go command parameters
+extern "C" PyObject* pyffish_search(PyObject* self, PyObject *args) {
+    PyObject *moveList;
+    Position pos;
+    const char *fen, *variant, *goParams = "depth 10";
+
+    int chess960 = false;
+    if (!PyArg_ParseTuple(args, "ssO!|sp", &variant, &fen, &PyList_Type, &moveList, &goParams, &chess960)) {
+        return NULL;
+    }
+
+    // Endgames are only needed for searches
+    static bool endgamesInitialized = false;
+    if (!endgamesInitialized)
+    {
+        Endgames::init();
+        endgamesInitialized = true;
+    }
+    // Info lines are not wanted in the output, the search is summarized in the result
+    std::streambuf* out = std::cout.rdbuf(nullptr);
+    if (std::string(Options["UCI_Variant"]) != variant)
+        Options["UCI_Variant"] = std::string(variant); // Loads the variant's evaluation
+
+    StateListPtr states(new std::deque<StateInfo>(1));
+    buildPosition(pos, states, variant, fen, moveList, chess960);
+    if (PyErr_Occurred())
+    {
+        std::cout.rdbuf(out);
+        return NULL;
+    }
+
+    Search::LimitsType limits;
+    limits.startTime = now();
+    std::istringstream is(goParams);
+    UCI::parse_limits(pos, is, limits);
+    limits.infinite = 0; // Nobody could stop it while the caller is blocked
+    if (!limits.has_limit())
+    {
+        std::cout.rdbuf(out);
+        PyErr_SetString(PyExc_ValueError, "The search needs a depth, nodes, movetime, mate or clock limit");
+        return NULL;
+    }
+
+    // The GIL stays held, since any other call would reinitialize the variant
+    // and the position state under the running search threads
+    Threads.start_thinking(pos, states, limits);
+    Threads.main()->wait_for_search_finished();
+    std::cout.rdbuf(out);
+
+    const Search::RootMove& rm = Threads.get_best_thread()->rootMoves[0];
+    Value score = rm.score;
+    if (rm.pv[0] == MOVE_NONE && !pos.is_game_end(score))
+        score = pos.checkers() ? pos.checkmate_value() : pos.stalemate_value();
+    PyObject *pv = PyList_New(0);
+    for (Move m : rm.pv)
+        if (m != MOVE_NONE)
+        {
+            PyObject *moveStr = Py_BuildValue("s", UCI::move(pos, m).c_str());
+            PyList_Append(pv, moveStr);
+            Py_XDECREF(moveStr);
+        }
+
+    PyObject *Result = Py_BuildValue("{s:s,s:s,s:s,s:O,s:i,s:K,s:L}",
+                                     "bestmove", UCI::move(pos, rm.pv[0]).c_str(),
+                                     "ponder", rm.pv.size() > 1 ? UCI::move(pos, rm.pv[1]).c_str() : "",
+                                     "score", UCI::value(score).c_str(),
+                                     "pv", pv,
+                                     "depth", int(Threads.get_best_thread()->completedDepth),
+                                     "nodes", (unsigned long long)Threads.nodes_searched(),
+                                     "time", (long long)(now() - limits.startTime));
+    Py_XDECREF(pv);
+    return Result;
+}
+
+// Iterator over the games of a PGN file object, string or bytes buffer
+struct PgnReaderObject {
+    PyObject_HEAD
+    PyObject* source; // file object or buffer
+    Py_ssize_t offset; // read position in a buffer
+    bool finished;
+    PGN::Reader* reader;
+};
+
+static PyTypeObject* PgnReaderType;
+static const Py_ssize_t PgnChunkSize = 1 << 16;
+
+static void PgnReader_dealloc(PgnReaderObject* self) {
+    delete self->reader;
+    Py_XDECREF(self->source);
+    PyTypeObject* type = Py_TYPE(self);
+    type->tp_free(self);
+    Py_DECREF(type);
+}
+
+// Feeds the next chunk of the source to the reader, or finishes it at the end of the input
+static bool PgnReader_feed(PgnReaderObject* self) {
+    const char* data;
+    Py_ssize_t size;
+    PyObject* chunk = NULL;
+
+    if (PyObject_HasAttrString(self->source, "read"))
+    {
+        if (!(chunk = PyObject_CallMethod(self->source, "read", "n", PgnChunkSize)))
+            return false;
+    }
+    else
+    {
+        chunk = self->source;
+        Py_INCREF(chunk);
+    }
+
+    if (PyUnicode_Check(chunk))
+        data = PyUnicode_AsUTF8AndSize(chunk, &size);
+    else if (PyBytes_AsStringAndSize(chunk, const_cast<char**>(&data), &size) < 0)
+        data = NULL;
+    if (!data)
+    {
+        Py_DECREF(chunk);
+        return false;
+    }
+
+    // Buffers are fed in chunks as well, so only few games are queued at once
+    if (chunk == self->source)
+    {
+        Py_ssize_t begin = std::min(self->offset, size);
+        data += begin;
+        size = std::min(size - begin, PgnChunkSize);
+        self->offset = begin + size;
+    }
+
+    if (size)
+        self->reader->feed(data, size_t(size));
+    else
+    {
+        self->reader->finish();
+        self->finished = true;
+    }
+    Py_DECREF(chunk);
+    return true;
+}
+
+static PyObject* PgnReader_next(PgnReaderObject* self) {
+    PGN::Game game;
+    while (!self->reader->next(game))
+        if (self->finished || !PgnReader_feed(self))
+            return NULL;
+
+    PyObject* headers = PyDict_New();
+    for (const auto& [key, value] : game.headers)
+    {
+        PyObject* item = Py_BuildValue("s", value.c_str());
+        PyDict_SetItemString(headers, key.c_str(), item);
+        Py_XDECREF(item);
+    }
+    PyObject* moves = PyList_New(game.moves.size());
+    for (size_t i = 0; i < game.moves.size(); i++)
+        PyList_SET_ITEM(moves, i, Py_BuildValue("s", game.moves[i].c_str()));
+
+    PyObject* result = Py_BuildValue("{s:O,s:s,s:s,s:O,s:O,s:s,s:z}",
+                                     "headers", headers,
+                                     "variant", game.variant.c_str(),
+                                     "fen", game.fen.c_str(),
+                                     "chess960", game.chess960 ? Py_True : Py_False,
+                                     "moves", moves,
+                                     "result", game.result.c_str(),
+                                     "error", game.error.empty() ? NULL : game.error.c_str());
+    Py_XDECREF(headers);
+    Py_XDECREF(moves);
+    return result;
+}
+
+static PyType_Slot PgnReaderSlots[] = {
+    {Py_tp_dealloc, (void*)PgnReader_dealloc},
+    {Py_tp_iter, (void*)PyObject_SelfIter},
+    {Py_tp_iternext, (void*)PgnReader_next},
+    {Py_tp_doc, (void*)"Iterator over the games of a PGN source."},
+    {0, NULL},
+};
+
+static PyType_Spec PgnReaderSpec = {
+    "pyffish.PgnReader",
+    sizeof(PgnReaderObject),
+    0,
+    Py_TPFLAGS_DEFAULT,
+    PgnReaderSlots,
+};
+
+// INPUT file object, string or bytes, notation
+extern "C" PyObject* pyffish_readPgn(PyObject* self, PyObject *args) {
+    PyObject *source;
+    int notation = NOTATION_SAN;
+    if (!PyArg_ParseTuple(args, "O|i", &source, &notation)) {
+        return NULL;
+    }
+    if (!PyObject_HasAttrString(source, "read") && !PyUnicode_Check(source) && !PyBytes_Check(source))
+    {
+        PyErr_SetString(PyExc_TypeError, "Expected a file object, string or bytes");
+        return NULL;
+    }
+
+    PgnReaderObject* reader = PyObject_New(PgnReaderObject, PgnReaderType);
+    if (!reader)
+        return NULL;
+    Py_INCREF(source);
+    reader->source = source;
+    reader->offset = 0;
+    reader->finished = false;
+    reader->reader = new PGN::Reader(Threads.main(), Notation(notation));
+    return (PyObject*)reader;
+}
+
 
 static PyMethodDef PyFFishMethods[] = {
     {"version", (PyCFunction)pyffish_version, METH_NOARGS, "Get package version."},
@@ -364,6 +848,7 @@ static PyMethodDef PyFFishMethods[] = {
     {"get_san", (PyCFunction)pyffish_getSAN, METH_VARARGS, "Get SAN move from given FEN and UCI move."},
     {"get_san_moves", (PyCFunction)pyffish_getSANmoves, METH_VARARGS, "Get SAN movelist from given FEN and UCI movelist."},
     {"legal_moves", (PyCFunction)pyffish_legalMoves, METH_VARARGS, "Get legal moves from given FEN and movelist."},
+    {"legal_moves_san", (PyCFunction)pyffish_legalMovesSAN, METH_VARARGS, "Get legal moves in SAN from given FEN and movelist."},
     {"get_fen", (PyCFunction)pyffish_getFEN, METH_VARARGS, "Get resulting FEN from given FEN and movelist."},
     {"gives_check", (PyCFunction)pyffish_givesCheck, METH_VARARGS, "Get check status from given FEN and movelist."},
     {"game_result", (PyCFunction)pyffish_gameResult, METH_VARARGS, "Get result from given FEN, considering variant end, checkmate, and stalemate."},
@@ -371,6 +856,16 @@ static PyMethodDef PyFFishMethods[] = {
     {"is_optional_game_end", (PyCFunction)pyffish_isOptionalGameEnd, METH_VARARGS, "Get result from given FEN it rules enable game end by player."},
     {"has_insufficient_material", (PyCFunction)pyffish_hasInsufficientMaterial, METH_VARARGS, "Checks for insufficient material."},
     {"validate_fen", (PyCFunction)pyffish_validateFen, METH_VARARGS, "Validate an input FEN."},
+    {"validate_fens", (PyCFunction)pyffish_validateFens, METH_VARARGS, "Validate a list of FENs and get an array of the results."},
+    {"get_packed", (PyCFunction)pyffish_getPacked, METH_VARARGS, "Get packed binary encoding of the position from given FEN and movelist."},
+    {"unpack_fen", (PyCFunction)pyffish_unpackFen, METH_VARARGS, "Get FEN from packed binary encoding of a position."},
+    {"legal_moves_array", (PyCFunction)pyffish_legalMovesArray, METH_VARARGS, "Get legal moves as an array of packed moves from given FEN and movelist."},
+    {"get_planes", (PyCFunction)pyffish_getPlanes, METH_VARARGS, "Get piece and pocket planes of the position from given FEN and movelist."},
+    {"get_plane_pieces", (PyCFunction)pyffish_getPlanePieces, METH_VARARGS, "Get the pieces of the planes of a variant."},
+    {"decode_move", (PyCFunction)pyffish_decodeMove, METH_VARARGS, "Get origin, destination, type and piece of a move of legal_moves_array."},
+    {"replay_game", (PyCFunction)pyffish_replayGame, METH_VARARGS, "Get FEN, SAN, check and game end status per ply from given FEN and movelist."},
+    {"read_pgn", (PyCFunction)pyffish_readPgn, METH_VARARGS, "Iterate over the games of a PGN file object, string or bytes."},
+    {"search", (PyCFunction)pyffish_search, METH_VARARGS, "Search the position from given FEN and movelist with the limits of a UCI go command."},
     {NULL, NULL, 0, NULL},  // sentinel
 };
 
@@ -382,7 +877,7 @@ static PyModuleDef pyffishmodule = {
     PyFFishMethods,
 };
 
-PyMODINIT_FUNC PyInit_pyffish() {
+PyMODINIT_FUNC PYFFISH_INIT(PYFFISH_MODULE)() {
     PyObject* module;
 
     module = PyModule_Create(&pyffishmodule);
@@ -393,6 +888,8 @@ PyMODINIT_FUNC PyInit_pyffish() {
     Py_INCREF(PyFFishError);
     PyModule_AddObject(module, "error", PyFFishError);
 
+    PyModule_AddStringConstant(module, "arch", PYFFISH_ARCH);
+
     // values
     PyModule_AddObject(module, "VALUE_MATE", PyLong_FromLong(VALUE_MATE));
     PyModule_AddObject(module, "VALUE_DRAW", PyLong_FromLong(VALUE_DRAW));
@@ -412,6 +909,14 @@ PyMODINIT_FUNC PyInit_pyffish() {
     // validation
     PyModule_AddObject(module, "FEN_OK", PyLong_FromLong(FEN::FEN_OK));
 
+    // PGN reader
+    PgnReaderType = (PyTypeObject*)PyType_FromSpec(&PgnReaderSpec);
+    if (PgnReaderType == NULL) {
+        return NULL;
+    }
+    Py_INCREF(PgnReaderType);
+    PyModule_AddObject(module, "PgnReader", (PyObject*)PgnReaderType);
+
     // initialize stockfish
     pieceMap.init();
     variants.init();
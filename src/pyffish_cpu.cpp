@@ -0,0 +1,54 @@
+/*
+  Fairy-Stockfish, a UCI chess variant playing engine derived from Stockfish
+  Copyright (C) 2018-2022 Fabian Fichter
+
+  Fairy-Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Fairy-Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// CPU detection of the pyffish package, which uses it to choose the build to load.
+// It is a module of its own, so that no build needs to be loaded for the detection.
+
+#include <Python.h>
+
+#include "cpu.h"
+
+using namespace Stockfish;
+
+extern "C" PyObject* pyffish_cpu_supportedArchs(PyObject* self) {
+    PyObject* archList = PyList_New(0);
+    for (const std::string& arch : CPU::supported_archs(CPU::detect()))
+    {
+        PyObject* archStr = Py_BuildValue("s", arch.c_str());
+        PyList_Append(archList, archStr);
+        Py_XDECREF(archStr);
+    }
+    return archList;
+}
+
+static PyMethodDef PyFFishCpuMethods[] = {
+    {"supported_archs", (PyCFunction)pyffish_cpu_supportedArchs, METH_NOARGS, "Get the architectures supported by the CPU, fastest first."},
+    {NULL, NULL, 0, NULL},  // sentinel
+};
+
+static PyModuleDef pyffishcpumodule = {
+    PyModuleDef_HEAD_INIT,
+    "_cpu",
+    "CPU feature detection of pyffish.",
+    -1,
+    PyFFishCpuMethods,
+};
+
+PyMODINIT_FUNC PyInit__cpu() {
+    return PyModule_Create(&pyffishcpumodule);
+}
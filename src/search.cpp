@@ -17,6 +17,7 @@
 */
 
 #include <algorithm>
+#include <array>
 #include <cassert>
 #include <cmath>
 #include <cstring>   // For std::memset
@@ -104,6 +105,63 @@ namespace {
     Move best = MOVE_NONE;
   };
 
+  // Ways of sharing the work between the threads, see the "SMP Mode" option
+  enum SmpMode { SMP_LAZY, SMP_BREADCRUMBS, SMP_ABDADA };
+  SmpMode smpMode = SMP_LAZY;
+
+  // Breadcrumbs are used to mark nodes as being searched by a given thread
+  struct Breadcrumb {
+    std::atomic<Thread*> thread;
+    std::atomic<Key> key;
+  };
+  std::array<Breadcrumb, 1024> breadcrumbs;
+
+  // Only nodes near the root are marked, deeper subtrees are too small to be shared
+  constexpr int BreadcrumbPlies = 8;
+
+  // ThreadHolding structure keeps track of which thread left breadcrumbs at the given
+  // node for potential reductions or deferrals. A free node will be marked upon entering
+  // the moves loop by the constructor, and unmarked upon leaving that loop by the destructor.
+  struct ThreadHolding {
+    explicit ThreadHolding(Thread* thisThread, Key posKey, int ply) {
+       location = smpMode != SMP_LAZY && ply < BreadcrumbPlies ? &breadcrumbs[posKey & (breadcrumbs.size() - 1)] : nullptr;
+       otherThread = false;
+       owning = false;
+       if (location)
+       {
+          // See if another already marked this location, if not, mark it ourselves
+          Thread* tmp = (*location).thread.load(std::memory_order_relaxed);
+          if (tmp == nullptr)
+          {
+              (*location).thread.store(thisThread, std::memory_order_relaxed);
+              (*location).key.store(posKey, std::memory_order_relaxed);
+              owning = true;
+          }
+          else if (   tmp != thisThread
+                   && (*location).key.load(std::memory_order_relaxed) == posKey)
+              otherThread = true;
+       }
+    }
+
+    ~ThreadHolding() {
+       if (owning) // Free the marked location
+           (*location).thread.store(nullptr, std::memory_order_relaxed);
+    }
+
+    bool marked() { return otherThread; }
+
+    private:
+    Breadcrumb* location;
+    bool otherThread, owning;
+  };
+
+  // Whether the node with the given key is being searched by another thread
+  bool searched_by_other(const Thread* thisThread, Key key) {
+    const Breadcrumb& b = breadcrumbs[key & (breadcrumbs.size() - 1)];
+    Thread* th = b.thread.load(std::memory_order_relaxed);
+    return th && th != thisThread && b.key.load(std::memory_order_relaxed) == key;
+  }
+
   template <NodeType nodeType>
   Value search(Position& pos, Stack* ss, Value alpha, Value beta, Depth depth, bool cutNode);
 
@@ -213,6 +271,11 @@ void MainThread::search() {
   }
   else
   {
+      const std::string mode = Options["SMP Mode"];
+      smpMode =  Threads.size() == 1 ? SMP_LAZY
+               : mode == "ABDADA"    ? SMP_ABDADA
+               : mode == "Breadcrumbs" ? SMP_BREADCRUMBS : SMP_LAZY;
+
       Threads.start_searching(); // start non-main threads
       Thread::search();          // main thread start searching
   }
@@ -255,9 +318,21 @@ void MainThread::search() {
 
   bestPreviousScore = bestThread->rootMoves[0].score;
 
-  // Send again PV info if we have a new best thread
-  if (bestThread != this)
-      sync_cout << UCI::pv(bestThread->rootPos, bestThread->completedDepth, -VALUE_INFINITE, VALUE_INFINITE) << sync_endl;
+  if (Time.logging() && Limits.use_time_management())
+      Time.log_move(rootPos, Limits, bestThread->completedDepth);
+
+  // Send again PV info if we have a new best thread or it got lost
+  if (bestThread != this || pvDropped)
+      sync_post(UCI::pv(bestThread->rootPos, bestThread->completedDepth, -VALUE_INFINITE, VALUE_INFINITE), true);
+
+  // The search information must precede the best move
+  sync_flush();
+
+  // Keep the result, the next search may continue from it
+  if (bestThread->completedDepth && bestThread->rootMoves[0].pv[0] != MOVE_NONE)
+      Threads.continuation.save(bestThread->rootPos, bestThread->rootMoves, bestThread->completedDepth);
+  else
+      Threads.continuation.clear();
 
   if (CurrentProtocol == XBOARD)
   {
@@ -317,11 +392,14 @@ void Thread::search() {
   Value bestValue, alpha, beta, delta;
   Move  lastBestMove = MOVE_NONE;
   Depth lastBestMoveDepth = 0;
-  MainThread* mainThread = (this == Threads.main() ? Threads.main() : nullptr);
+  // In a batch job every thread searches on its own, without reporting
+  MainThread* mainThread = (this == Threads.main() && !Threads.batch ? Threads.main() : nullptr);
   double timeReduction = 1, totBestMoveChanges = 0;
   Color us = rootPos.side_to_move();
   int iterIdx = 0;
 
+  size_eval_tables();
+
   std::memset(ss-7, 0, 10 * sizeof(Stack));
   for (int i = 7; i > 0; i--)
       (ss-i)->continuationHistory = &this->continuationHistory[0][0][NO_PIECE][0]; // Use as a sentinel
@@ -344,8 +422,11 @@ void Thread::search() {
               mainThread->iterValue[i] = mainThread->bestPreviousScore;
   }
 
-  std::copy(&lowPlyHistory[2][0], &lowPlyHistory.back().back() + 1, &lowPlyHistory[0][0]);
-  std::fill(&lowPlyHistory[MAX_LPH - 2][0], &lowPlyHistory.back().back() + 1, 0);
+  // Shift lowPlyHistory by the plies played since the previous search
+  auto lphBegin = &lowPlyHistory[0][0], lphEnd = &lowPlyHistory.back().back() + 1;
+  size_t lphShift = std::min(rootPlies, MAX_LPH) * lowPlyHistory[0].size();
+  std::copy(lphBegin + lphShift, lphEnd, lphBegin);
+  std::fill(lphEnd - lphShift, lphEnd, 0);
 
   size_t multiPV = size_t(Options["MultiPV"]);
 
@@ -380,7 +461,8 @@ void Thread::search() {
   // Iterative deepening loop until requested to stop or the target depth is reached
   while (   ++rootDepth < MAX_PLY
          && !Threads.stop
-         && !(Limits.depth && mainThread && rootDepth > Limits.depth))
+         && !(Limits.depth && (mainThread || Threads.batch) && rootDepth > Limits.depth)
+         && !(Threads.batch && Threads.batch->nodes && completedDepth && nodes >= uint64_t(Threads.batch->nodes)))
   {
       // Age out PV variability metric
       if (mainThread)
@@ -455,7 +537,7 @@ void Thread::search() {
                   && multiPV == 1
                   && (bestValue <= alpha || bestValue >= beta)
                   && Time.elapsed() > 3000)
-                  sync_cout << UCI::pv(rootPos, rootDepth, alpha, beta) << sync_endl;
+                  sync_post(UCI::pv(rootPos, rootDepth, alpha, beta));
 
               // In case of failing low/high increase aspiration window and
               // re-search, otherwise exit the loop.
@@ -486,7 +568,10 @@ void Thread::search() {
 
           if (    mainThread
               && (Threads.stop || pvIdx + 1 == multiPV || Time.elapsed() > 3000))
-              sync_cout << UCI::pv(rootPos, rootDepth, alpha, beta) << sync_endl;
+          {
+              mainThread->pvDropped = !sync_post(UCI::pv(rootPos, rootDepth, alpha, beta), Threads.stop);
+              Threads.latency.info_sent();
+          }
       }
 
       if (!Threads.stop)
@@ -538,6 +623,10 @@ void Thread::search() {
           if (rootMoves.size() == 1)
               totalTime = std::min(500.0, totalTime);
 
+          if (Time.logging())
+              Time.log_iteration({ completedDepth, Time.elapsed(), fallingEval, reduction,
+                                   bestMoveInstability, totBestMoveChanges });
+
           // Update partner in bughouse variants
           if (completedDepth >= 8 && rootPos.two_boards() && CurrentProtocol == XBOARD)
           {
@@ -613,7 +702,10 @@ void Thread::search() {
               if (mainThread->ponder)
                   mainThread->stopOnPonderhit = true;
               else if (!(rootPos.two_boards() && (Partner.sitRequested || Partner.weDead)))
+              {
+                  Time.log_stop("optimum");
                   Threads.stop = true;
+              }
           }
           else if (   Threads.increaseDepth
                    && !mainThread->ponder
@@ -1089,9 +1181,18 @@ moves_loop: // When in check, search starts from here
                          && (tte->bound() & BOUND_UPPER)
                          && tte->depth() >= depth;
 
+    // Mark this node as being searched
+    ThreadHolding th(thisThread, posKey, ss->ply);
+
+    // Moves whose subtrees are being searched by other threads (ABDADA), they
+    // are searched after all the other moves.
+    Move deferredMoves[32];
+    int deferredCount = 0, deferredIdx = 0;
+
     // Step 12. Loop through all pseudo-legal moves until no moves remain
     // or a beta cutoff occurs.
-    while ((move = mp.next_move(moveCountPruning)) != MOVE_NONE)
+    while (   (move = mp.next_move(moveCountPruning)) != MOVE_NONE
+           || (deferredIdx < deferredCount && (move = deferredMoves[deferredIdx++]) != MOVE_NONE))
     {
       assert(is_ok(move));
 
@@ -1110,12 +1211,25 @@ moves_loop: // When in check, search starts from here
       if (!rootNode && !pos.legal(move))
           continue;
 
+      // In ABDADA mode, postpone a move if another thread is already searching it
+      if (   smpMode == SMP_ABDADA
+          && !rootNode
+          && moveCount
+          && !deferredIdx
+          && ss->ply + 1 < BreadcrumbPlies
+          && deferredCount < int(std::size(deferredMoves))
+          && searched_by_other(thisThread, pos.key_after(move)))
+      {
+          deferredMoves[deferredCount++] = move;
+          continue;
+      }
+
       ss->moveCount = ++moveCount;
 
-      if (rootNode && thisThread == Threads.main() && Time.elapsed() > 3000 && is_uci_dialect(CurrentProtocol))
-          sync_cout << "info depth " << depth
-                    << " currmove " << UCI::move(pos, move)
-                    << " currmovenumber " << moveCount + thisThread->pvIdx << sync_endl;
+      if (rootNode && thisThread == Threads.main() && !Threads.batch && Time.elapsed() > 3000 && is_uci_dialect(CurrentProtocol))
+          sync_post(  "info depth " + std::to_string(depth)
+                    + " currmove " + UCI::move(pos, move)
+                    + " currmovenumber " + std::to_string(moveCount + thisThread->pvIdx));
       if (PvNode)
           (ss+1)->pv = nullptr;
 
@@ -1281,6 +1395,10 @@ moves_loop: // When in check, search starts from here
           if (PvNode)
               r--;
 
+          // Increase reduction if other threads are searching this position
+          if (th.marked())
+              r++;
+
           // Decrease reduction if the ttHit running average is large (~0 Elo)
           if (thisThread->ttHitAverage > 537 * TtHitAverageResolution * TtHitAverageWindow / 1024)
               r--;
@@ -1950,9 +2068,13 @@ void MainThread::check_time() {
       && (Partner.sitRequested || (Partner.weDead && !Partner.partnerDead) || Partner.weVirtualWin))
       return;
 
-  if (   (Limits.use_time_management() && (elapsed > Time.maximum() - 10 || stopOnPonderhit))
-      || (Limits.movetime && elapsed >= Limits.movetime)
-      || (Limits.nodes && Threads.nodes_searched() >= (uint64_t)Limits.nodes))
+  if (Limits.use_time_management() && (elapsed > Time.maximum() - 10 || stopOnPonderhit))
+  {
+      Time.log_stop(stopOnPonderhit ? "ponderhit" : "maximum");
+      Threads.stop = true;
+  }
+  else if (   (Limits.movetime && elapsed >= Limits.movetime)
+           || (Limits.nodes && Threads.nodes_searched() >= (uint64_t)Limits.nodes))
       Threads.stop = true;
 }
 
@@ -96,6 +96,11 @@ struct LimitsType {
     return time[WHITE] || time[BLACK];
   }
 
+  // Whether the search ends by itself, without a stop command
+  bool has_limit() const {
+    return use_time_management() || movetime || depth || nodes || mate || perft;
+  }
+
   std::vector<Move> searchmoves, banmoves;
   TimePoint time[COLOR_NB], inc[COLOR_NB], npmsec, movetime, startTime;
   int movestogo, depth, mate, perft, infinite;
@@ -0,0 +1,409 @@
+/*
+  Fairy-Stockfish, a UCI chess variant playing engine derived from Stockfish
+  Copyright (C) 2018-2022 Fabian Fichter
+
+  Fairy-Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Fairy-Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <streambuf>
+#include <string>
+#include <thread>
+
+#if !defined(_WIN32) && !defined(__EMSCRIPTEN__)
+#define USE_SERVER
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include "fen.h"
+#include "misc.h"
+#include "position.h"
+#include "search.h"
+#include "thread.h"
+#include "uci.h"
+
+using namespace std;
+
+namespace Stockfish {
+
+namespace UCI {
+  extern void position(Position& pos, istream& is, StateListPtr& states);
+  extern bool parse_limits(const Position& pos, istream& is, Search::LimitsType& limits);
+}
+
+#ifdef USE_SERVER
+
+namespace {
+
+constexpr uint32_t MaxFrameSize = 1 << 20;
+
+/// Messages are framed by their length as a 4 byte little endian integer,
+/// followed by the message itself. A client sends one command per frame and
+/// receives one line of output per frame.
+
+bool read_all(int fd, char* data, size_t size) {
+
+  while (size)
+  {
+      ssize_t n = read(fd, data, size);
+      if (n <= 0)
+          return false;
+      data += n, size -= size_t(n);
+  }
+  return true;
+}
+
+bool read_frame(int fd, string& msg) {
+
+  unsigned char len[4];
+  if (!read_all(fd, reinterpret_cast<char*>(len), 4))
+      return false;
+
+  uint32_t size = len[0] | len[1] << 8 | len[2] << 16 | uint32_t(len[3]) << 24;
+  if (size > MaxFrameSize)
+      return false;
+
+  msg.resize(size);
+  return read_all(fd, &msg[0], size);
+}
+
+void write_frame(int fd, const string& msg) {
+
+  string frame(4, '\0');
+  for (int i = 0; i < 4; ++i)
+      frame[i] = char(msg.size() >> (8 * i));
+  frame += msg;
+
+  for (size_t done = 0; done < frame.size(); )
+  {
+      ssize_t n = send(fd, frame.data() + done, frame.size() - done, MSG_NOSIGNAL);
+      if (n <= 0)
+          return;
+      done += size_t(n);
+  }
+}
+
+
+/// valid_position() checks the FEN of the arguments of a "position" command, since
+/// a malformed FEN of one client must not take down the sessions of all others.
+/// SFENs can not be checked and are not accepted.
+
+bool valid_position(const string& args) {
+
+  istringstream is(args);
+  string token, fen;
+
+  is >> token;
+  if (token != "fen")
+      return token == "startpos";
+
+  while (is >> token && token != "moves")
+      fen += (fen.empty() ? "" : " ") + token;
+
+  return FEN::check_fen(fen, variants.find(Options["UCI_Variant"])->second, Options["UCI_Chess960"]) == FEN::FEN_OK;
+}
+
+
+/// Session keeps the state of a client connection. Its position is kept as the
+/// arguments of its last "position" command and only set up when a search
+/// starts. The search fields are owned by the scheduler while a search is pending.
+
+struct Session {
+
+  explicit Session(int f) : fd(f) {}
+ ~Session() { close(fd); }
+
+  void send(const string& line) {
+    lock_guard<mutex> lk(writeMutex);
+    write_frame(fd, line);
+  }
+
+  const int fd;
+  string position = "startpos";
+  string searchPosition, go;
+  bool pending = false;
+  atomic_bool stopRequested{false};
+
+private:
+  mutex writeMutex;
+};
+
+
+/// SessionBuf is the stream buffer of std::cout while a search of the session
+/// is running, forwarding every line of the search output to the client. The
+/// bestmove line is held back until the session can start its next search.
+
+class SessionBuf : public streambuf {
+
+public:
+  explicit SessionBuf(Session& s) : session(s) {}
+
+  string bestmove;
+
+protected:
+  int overflow(int c) override {
+    if (c == '\n')
+    {
+        if (line.compare(0, 8, "bestmove") == 0)
+            bestmove = line;
+        else
+            session.send(line);
+        line.clear();
+    }
+    else if (c != EOF)
+        line += char(c);
+    return c;
+  }
+
+private:
+  Session& session;
+  string line;
+};
+
+
+/// Scheduler runs a single search at a time on the whole thread pool. The
+/// searches of the sessions are queued in the order they were requested, and
+/// all of them share the transposition table, the histories and the options.
+/// Every search is limited to the turn time, so that a long search can not hold
+/// up the other sessions. The time spent in the queue is not taken off the
+/// clocks of a session, so clocked games need to allow for it.
+
+class Scheduler {
+
+public:
+  Scheduler() : worker(&Scheduler::idle_loop, this) { worker.detach(); }
+
+  atomic<TimePoint> turnTime{10000};
+
+  void submit(const shared_ptr<Session>& s, const string& args) {
+    lock_guard<mutex> lk(mtx);
+    if (s->pending)
+    {
+        s->send("info string Search already running");
+        return;
+    }
+    s->searchPosition = s->position;
+    s->go = args;
+    s->pending = true;
+    s->stopRequested = false;
+    queue.push_back(s);
+    cv.notify_one();
+  }
+
+  // The flag is checked again once the search has started, since starting it
+  // clears Threads.stop
+  void stop(const shared_ptr<Session>& s) {
+    lock_guard<mutex> lk(mtx);
+    s->stopRequested = true;
+    if (current == s)
+        Threads.stop = true;
+  }
+
+  // Drops a closed session, its search is not needed anymore
+  void remove(const shared_ptr<Session>& s) {
+    lock_guard<mutex> lk(mtx);
+    s->stopRequested = true;
+    if (current == s)
+        Threads.stop = true;
+    for (auto it = queue.begin(); it != queue.end(); )
+        it = *it == s ? queue.erase(it) : it + 1;
+  }
+
+private:
+  void idle_loop() {
+    while (true)
+    {
+        unique_lock<mutex> lk(mtx);
+        cv.wait(lk, [&]{ return !queue.empty(); });
+        current = queue.front();
+        queue.pop_front();
+        lk.unlock();
+
+        string reply = run(*current);
+
+        lk.lock();
+        shared_ptr<Session> s = current;
+        s->pending = false;
+        current = nullptr;
+        lk.unlock();
+
+        if (!reply.empty())
+            s->send(reply);
+    }
+  }
+
+  // Returns the last line for the client, which is sent once the session is
+  // ready for the next search
+  string run(Session& s) {
+
+    Position pos;
+    StateListPtr states;
+    istringstream ps(s.searchPosition);
+    if (valid_position(s.searchPosition))
+        UCI::position(pos, ps, states);
+    if (!states)
+        return "info string Invalid position";
+
+    Search::LimitsType limits;
+    limits.startTime = now();
+    istringstream gs(s.go);
+    UCI::parse_limits(pos, gs, limits);
+    limits.movetime = limits.movetime ? std::min(limits.movetime, TimePoint(turnTime)) : TimePoint(turnTime);
+
+    SessionBuf buf(s);
+    cout << IO_LOCK;
+    streambuf* stdoutBuf = cout.rdbuf(&buf);
+    cout << IO_UNLOCK;
+
+    Threads.start_thinking(pos, states, limits);
+    if (s.stopRequested)
+        Threads.stop = true;
+    Threads.main()->wait_for_search_finished();
+
+    cout << IO_LOCK;
+    cout.rdbuf(stdoutBuf);
+    cout << IO_UNLOCK;
+
+    return buf.bestmove;
+  }
+
+  mutex mtx;
+  condition_variable cv;
+  deque<shared_ptr<Session>> queue;
+  shared_ptr<Session> current;
+  thread worker;
+};
+
+
+/// handle_session() processes the commands of a client until it disconnects
+
+void handle_session(shared_ptr<Session> s, Scheduler& scheduler) {
+
+  string msg, token;
+
+  while (read_frame(s->fd, msg))
+  {
+      istringstream is(msg);
+      token.clear();
+      is >> skipws >> token;
+
+      if (token == "quit")
+          break;
+
+      else if (token == "uci")
+      {
+          istringstream info(engine_info(true));
+          for (string line; getline(info, line); )
+              s->send(line);
+          s->send("uciok");
+      }
+      else if (token == "isready")    s->send("readyok");
+      else if (token == "ucinewgame") s->position = "startpos";
+      else if (token == "position")   getline(is, s->position);
+      else if (token == "stop")       scheduler.stop(s);
+      else if (token == "go")
+      {
+          string args;
+          getline(is, args);
+          if (   args.find("infinite") != string::npos
+              || args.find("ponder") != string::npos
+              || args.find("perft") != string::npos)
+              s->send("info string Infinite, ponder and perft searches are not supported by the server");
+          else
+              scheduler.submit(s, args);
+      }
+      else if (!token.empty())
+          s->send("info string Unknown command: '" + msg + "'");
+  }
+
+  scheduler.remove(s);
+}
+
+} // namespace
+
+#endif
+
+
+/// serve() is called when engine receives the "serve" command. The engine then
+/// accepts clients on a Unix domain socket, each of them being a session with its
+/// own position. The searches of all sessions run one at a time on the shared
+/// search state, see Scheduler. Options are shared and need to be set before
+/// starting the server. Every search is stopped after the turn time
+/// in milliseconds. The command only returns if the socket fails, the engine
+/// does not read further commands from stdin.
+///
+/// serve socket=/tmp/fairy-stockfish.sock turntime=10000
+
+void serve(istream& is) {
+
+  string token, path = "/tmp/fairy-stockfish.sock";
+  TimePoint turnTime = 10000;
+
+  while (is >> token)
+      if (token.find("socket=") == 0)
+          path = token.substr(7);
+      else if (token.find("turntime=") == 0)
+          turnTime = std::max(TimePoint(atoll(token.substr(9).c_str())), TimePoint(1));
+
+#ifdef USE_SERVER
+  sockaddr_un addr = {};
+  addr.sun_family = AF_UNIX;
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+  if (fd < 0 || path.size() >= sizeof(addr.sun_path))
+  {
+      sync_cout << "info string Unable to open socket " << path << sync_endl;
+      return;
+  }
+
+  path.copy(addr.sun_path, path.size());
+
+  // Replace the socket of a previous server, but never any other file
+  struct stat st;
+  if (lstat(path.c_str(), &st) == 0 && S_ISSOCK(st.st_mode))
+      unlink(path.c_str());
+
+  if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || listen(fd, 16) < 0)
+  {
+      sync_cout << "info string Unable to open socket " << path << sync_endl;
+      close(fd);
+      return;
+  }
+
+  sync_cout << "info string Serving on " << path << sync_endl;
+
+  static Scheduler scheduler;
+  scheduler.turnTime = turnTime;
+
+  for (int client; (client = accept(fd, nullptr, nullptr)) >= 0; )
+      thread(handle_session, make_shared<Session>(client), ref(scheduler)).detach();
+
+  close(fd);
+#else
+  sync_cout << "info string Server mode is not supported on this platform" << sync_endl;
+#endif
+}
+
+} // namespace Stockfish
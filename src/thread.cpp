@@ -18,7 +18,9 @@
 
 #include <cassert>
 
-#include <algorithm> // For std::count
+#include <algorithm> // For std::count, std::find and std::rotate
+#include <iostream>
+#include "fen.h"
 #include "movegen.h"
 #include "partner.h"
 #include "search.h"
@@ -55,6 +57,26 @@ Thread::~Thread() {
 }
 
 
+/// Thread::operator new() places the threads, most of which are their history
+/// tables, in large pages if possible.
+
+void* Thread::operator new(size_t size) {
+
+  void* mem = aligned_large_pages_alloc(size, "Threads");
+  if (!mem)
+  {
+      std::cerr << "Failed to allocate " << size << " bytes for a thread." << std::endl;
+      std::exit(EXIT_FAILURE);
+  }
+  return mem;
+}
+
+void Thread::operator delete(void* ptr) {
+
+  aligned_large_pages_free(ptr);
+}
+
+
 /// Thread::clear() reset histories, usually before a new game
 
 void Thread::clear() {
@@ -63,6 +85,9 @@ void Thread::clear() {
   mainHistory.fill(0);
   lowPlyHistory.fill(0);
   captureHistory.fill(0);
+  pawnsTable.probes = pawnsTable.hits = 0;
+  materialTable.probes = materialTable.hits = 0;
+  evalCache.probes = evalCache.hits = 0;
 
   for (bool inCheck : { false, true })
       for (StatsType c : { NoCaptures, Captures })
@@ -75,6 +100,40 @@ void Thread::clear() {
 }
 
 
+/// Thread::size_eval_tables() sizes the pawn and material tables for the variant
+/// of the root position, or as set by the "Eval Hash" option, and enables the
+/// evaluation cache if the variant asks for it. It is called when a search
+/// starts and keeps the entries as long as the size does not change.
+
+void Thread::size_eval_tables() {
+
+  const Variant* v = rootPos.variant();
+  bool hasPawns = v->pieceTypes.count(PAWN);
+  size_t bytes = size_t(Options["Eval Hash"]) << 20;
+
+  // Without pawns there is only the pawn key of no pawns, whose entry is kept
+  // with the thread instead of a table
+  pawnless = !hasPawns;
+  pawnlessEntry.key = 0;
+  if (bytes)
+  {
+      pawnsTable.resize(hasPawns ? bytes / 2 / sizeof(Pawns::Entry) : 1);
+      materialTable.resize((hasPawns ? bytes / 2 : bytes) / sizeof(Material::Entry));
+  }
+  else
+  {
+      // Pieces in hand and more piece types multiply the material configurations
+      pawnsTable.resize(hasPawns ? 131072 : 1);
+      materialTable.resize(size_t(8192) << ((v->pieceDrops ? 3 : 0) + (v->pieceTypes.size() > 6)));
+  }
+
+  // Most static evaluations are already kept in the TT entries, so the cache
+  // only pays off where the evaluation is expensive and the TT under pressure
+  std::string cache = Options["Eval Cache"];
+  useEvalCache = cache == "On" || (cache == "Auto" && v->evalCache);
+}
+
+
 /// Thread::start_searching() wakes up the thread that will start the search
 
 void Thread::start_searching() {
@@ -126,10 +185,38 @@ void Thread::idle_loop() {
 
       lk.unlock();
 
-      search();
+      if (Threads.batch)
+          Threads.batch->run(*this);
+      else
+      {
+          // Threads set up their root position in parallel, copying the
+          // snapshot of the pool instead of parsing a FEN.
+          rootMoves = Threads.rootMoves;
+          rootPos.set(Threads.rootPos, &rootState, this);
+          Threads.latency.thread_ready(Threads.size());
+          search();
+      }
   }
 }
 
+
+/// Thread::batch_search() searches rootPos on its own, as part of a batch job.
+/// The result is left in rootMoves, which is empty if there are no legal moves.
+
+void Thread::batch_search() {
+
+  rootMoves.clear();
+  for (const auto& m : MoveList<LEGAL>(rootPos))
+      rootMoves.emplace_back(m);
+
+  nodes = tbHits = nmpMinPly = bestMoveChanges = 0;
+  rootDepth = completedDepth = 0;
+  rootPlies = 2;
+
+  if (!rootMoves.empty())
+      Thread::search();
+}
+
 /// ThreadPool::set() creates/destroys threads to match the requested number.
 /// Created and launched threads will immediately go to sleep in idle_loop.
 /// Upon resizing, threads are recreated to allow for binding if necessary.
@@ -171,6 +258,7 @@ void ThreadPool::clear() {
   main()->callsCnt = 0;
   main()->bestPreviousScore = VALUE_INFINITE;
   main()->previousTimeReduction = 1.0;
+  continuation.clear();
 }
 
 
@@ -182,34 +270,52 @@ void ThreadPool::start_thinking(Position& pos, StateListPtr& states,
 
   main()->wait_for_search_finished();
 
-  main()->stopOnPonderhit = stop = abort = false;
+  latency.start();
+  main()->stopOnPonderhit = main()->pvDropped = stop = abort = false;
   increaseDepth = true;
   main()->ponder = ponderMode;
   Search::Limits = limits;
-  Search::RootMoves rootMoves;
+  rootMoves.clear();
 
   for (const auto& m : MoveList<LEGAL>(pos))
       if (   (limits.searchmoves.empty() || std::count(limits.searchmoves.begin(), limits.searchmoves.end(), m))
           && (limits.banmoves.empty() || !std::count(limits.banmoves.begin(), limits.banmoves.end(), m)))
           rootMoves.emplace_back(m);
 
-  // Add virtual drops
+  // Add virtual drops, only of the pieces expected from the partner board if known
   if (pos.two_boards() && Partner.opptime && limits.time[pos.side_to_move()] > Partner.opptime + 1000)
   {
+      size_t realMoves = rootMoves.size();
       if (pos.checkers())
       {
           for (const auto& m : MoveList<EVASIONS>(pos))
-              if (pos.virtual_drop(m) && pos.legal(m))
+              if (pos.virtual_drop(m) && Partner.expect_drop(pos.side_to_move(), in_hand_piece_type(m)) && pos.legal(m))
                   rootMoves.emplace_back(m);
       }
       else
       {
           for (const auto& m : MoveList<QUIETS>(pos))
-              if (pos.virtual_drop(m) && pos.legal(m))
+              if (pos.virtual_drop(m) && Partner.expect_drop(pos.side_to_move(), in_hand_piece_type(m)) && pos.legal(m))
                   rootMoves.emplace_back(m);
       }
+
+      // Search the drops of the most valuable expected pieces first
+      if (Partner.boardKnown)
+          std::stable_sort(rootMoves.begin() + realMoves, rootMoves.end(), [](const Search::RootMove& a, const Search::RootMove& b) {
+              return PieceValue[MG][in_hand_piece_type(a.pv[0])] > PieceValue[MG][in_hand_piece_type(b.pv[0])];
+          });
   }
 
+  // Continue from the previous search if the root lies on its PV, unless the
+  // search is limited in a way that asks for reproducible results.
+  int plies = continuation.plies_to(pos.key());
+  Depth startDepth = 0;
+  if (   plies >= 0
+      && !rootMoves.empty()
+      && !limits.depth && !limits.nodes && !limits.mate
+      && !Options["UCI_LimitStrength"] && double(Options["Skill Level"]) >= 20)
+      startDepth = continuation.restore(rootMoves, plies, size_t(Options["MultiPV"]));
+
   if (!rootMoves.empty())
       Tablebases::rank_root_moves(pos, rootMoves);
 
@@ -220,23 +326,239 @@ void ThreadPool::start_thinking(Position& pos, StateListPtr& states,
   if (states.get())
       setupStates = std::move(states); // Ownership transfer, states is now empty
 
-  // We use Position::set() to set root position across threads. But there are
-  // some StateInfo fields (previous, pliesFromNull, capturedPiece) that cannot
-  // be deduced from a fen string, so set() clears them and they are set from
-  // setupStates->back() later. The rootState is per thread, earlier states are shared
-  // since they are read-only.
+  // Take a snapshot of the root position, which the threads copy when they
+  // start searching. The state of the root is copied per thread, earlier
+  // states are shared since they are read-only. Counters are reset here, so
+  // that no stale values are seen by the main thread.
+  rootPos.set(pos, &rootState, nullptr);
+
   for (Thread* th : *this)
   {
       th->nodes = th->tbHits = th->nmpMinPly = th->bestMoveChanges = 0;
-      th->rootDepth = th->completedDepth = 0;
-      th->rootMoves = rootMoves;
-      th->rootPos.set(pos.variant(), pos.fen(), pos.is_chess960(), &th->rootState, th);
-      th->rootState = setupStates->back();
+      th->rootDepth = std::max(startDepth - 1, 0);
+      th->completedDepth = 0;
+      th->rootPlies = startDepth ? plies : 2; // Default shift unless continuing
   }
 
   main()->start_searching();
 }
 
+/// SearchContinuation::save() keeps the root moves of a finished search and the
+/// keys of the positions along its PV. It walks the PV on the given position,
+/// which is left unchanged.
+
+void SearchContinuation::save(Position& pos, const Search::RootMoves& rms, Depth d) {
+
+  const std::vector<Move>& pv = rms[0].pv;
+  std::vector<StateInfo> states(pv.size());
+  uint64_t nodes = pos.this_thread()->nodes; // Walking the PV is not searching
+  size_t i = 0;
+
+  rootMoves = rms;
+  depth = d;
+  keys.assign(1, pos.key());
+
+  // The last move of the PV has no continuation to offer
+  for ( ; i + 1 < pv.size() && pos.pseudo_legal(pv[i]) && pos.legal(pv[i]); ++i)
+  {
+      pos.do_move(pv[i], states[i]);
+      keys.push_back(pos.key());
+  }
+
+  while (i--)
+      pos.undo_move(pv[i]);
+
+  pos.this_thread()->nodes = nodes;
+}
+
+
+/// SearchContinuation::plies_to() returns how many plies along the PV of the
+/// previous search the position with the given key lies, or -1 if it does not.
+
+int SearchContinuation::plies_to(Key key) const {
+
+  auto it = std::find(keys.begin(), keys.end(), key);
+  return it != keys.end() ? int(it - keys.begin()) : -1;
+}
+
+
+/// SearchContinuation::restore() carries over the order and the scores of the
+/// previous root moves, or the PV move if the root has changed, and returns the
+/// depth at which iterative deepening can resume, or 0 to start from scratch.
+
+Depth SearchContinuation::restore(Search::RootMoves& rms, int plies, size_t multiPV) const {
+
+  if (plies == 0)
+  {
+      Search::RootMoves ordered;
+      for (const auto& rm : rootMoves)
+          if (std::count(rms.begin(), rms.end(), rm.pv[0]))
+              ordered.push_back(rm);
+      for (const auto& rm : rms)
+          if (!std::count(ordered.begin(), ordered.end(), rm.pv[0]))
+              ordered.push_back(rm);
+      rms = ordered;
+  }
+  else
+  {
+      const Search::RootMove& last = rootMoves[0];
+      auto it = std::find(rms.begin(), rms.end(), last.pv[plies]);
+      if (it == rms.end())
+          return 0;
+
+      std::rotate(rms.begin(), it, it + 1);
+      rms[0].pv.assign(last.pv.begin() + plies, last.pv.end());
+      // Mate and TB scores count the plies from the root, which is now closer to the end
+      Value v = plies % 2 ? -last.score : last.score;
+      rms[0].score = rms[0].previousScore =  v >= VALUE_TB_WIN_IN_MAX_PLY  ? v + plies
+                                           : v <= VALUE_TB_LOSS_IN_MAX_PLY ? v - plies : v;
+  }
+
+  // Aspiration windows need the score of every PV line to start from
+  for (size_t i = 0; i < std::min(multiPV, rms.size()); ++i)
+      if (rms[i].score == -VALUE_INFINITE)
+          return 0;
+
+  return std::max(depth - plies, 0);
+}
+
+
+/// GoLatency::start() is called when a 'go' command starts the threads
+
+void GoLatency::start() {
+
+  startTime = std::chrono::steady_clock::now();
+  readyThreads = 0;
+  infoPending = true;
+  ++count;
+}
+
+namespace {
+
+  uint64_t elapsed_us(std::chrono::steady_clock::time_point since) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - since).count();
+  }
+
+} // namespace
+
+void GoLatency::thread_ready(size_t threadCount) {
+
+  if (++readyThreads == threadCount)
+      setupTime += elapsed_us(startTime);
+}
+
+void GoLatency::info_sent() {
+
+  if (infoPending.exchange(false))
+      infoTime += elapsed_us(startTime);
+}
+
+
+/// ThreadPool::run_batch() runs a batch job on all threads and returns when
+/// all of them have finished their part of it.
+
+void ThreadPool::run_batch(BatchJob& b, const Search::LimitsType& limits) {
+
+  main()->wait_for_search_finished();
+
+  stop = abort = false;
+  increaseDepth = true;
+  Search::Limits = limits;
+  TT.new_search();
+  Eval::NNUE::verify();
+
+  batch = &b;
+
+  for (Thread* th : *this)
+      th->start_searching();
+
+  for (Thread* th : *this)
+      th->wait_for_search_finished();
+
+  batch = nullptr;
+}
+
+
+/// BatchAnalysis::run() searches positions until the input is exhausted. Invalid
+/// FENs are reported with the reason instead of a result.
+
+void BatchAnalysis::run(Thread& th) {
+
+  std::string fen;
+
+  while (next(fen))
+  {
+      FEN::FenValidation validation = FEN::check_fen(fen, variant, chess960);
+      if (validation != FEN::FEN_OK)
+      {
+          std::lock_guard<std::mutex> lk(mutex);
+          out << fen << "; error \"" << FEN::fen_validation_reason(validation) << "\"" << std::endl;
+          ++invalid;
+          continue;
+      }
+      th.rootPos.set(variant, fen, chess960, &th.rootState, &th);
+      th.batch_search();
+      report(th, fen);
+  }
+}
+
+
+/// BatchAnalysis::next() reads the next FEN from the input. Empty lines and
+/// comments are skipped, and anything after a semicolon is ignored, so that
+/// EPD files with operations can be used as input.
+
+bool BatchAnalysis::next(std::string& fen) {
+
+  std::lock_guard<std::mutex> lk(mutex);
+
+  while (std::getline(in, fen))
+  {
+      fen = fen.substr(0, fen.find(';'));
+      size_t first = fen.find_first_not_of(" \t\r");
+      if (first == std::string::npos || fen[first] == '#')
+          continue;
+
+      fen = fen.substr(first, fen.find_last_not_of(" \t\r") + 1 - first);
+      return true;
+  }
+
+  return false;
+}
+
+
+/// BatchAnalysis::report() writes the result of a search as an EPD line with
+/// the best move in coordinate notation, the score from the point of view of
+/// the side to move ("ce" in centipawns or "dm" for mates), the completed depth
+/// and the number of nodes.
+
+void BatchAnalysis::report(Thread& th, const std::string& fen) {
+
+  std::lock_guard<std::mutex> lk(mutex);
+
+  Position& pos = th.rootPos;
+  Value v, result;
+  Move best = MOVE_NONE;
+
+  if (th.rootMoves.empty())
+      v =  pos.is_game_end(result) ? result
+         : pos.checkers()          ? pos.checkmate_value()
+                                   : pos.stalemate_value();
+  else
+      v = th.rootMoves[0].score, best = th.rootMoves[0].pv[0];
+
+  out << fen << "; bm " << UCI::move(pos, best);
+
+  if (abs(v) >= VALUE_MATE_IN_MAX_PLY)
+      out << "; dm " << (v > 0 ? VALUE_MATE - v + 1 : -VALUE_MATE - v - 1) / 2;
+  else
+      out << "; ce " << v * 100 / PawnValueEg;
+
+  out << "; acd " << th.completedDepth << "; acn " << th.nodes << std::endl;
+
+  ++done;
+}
+
+
 Thread* ThreadPool::get_best_thread() const {
 
     Thread* bestThread = front();
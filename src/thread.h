@@ -20,11 +20,15 @@
 #define THREAD_H_INCLUDED
 
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <istream>
 #include <mutex>
+#include <ostream>
 #include <thread>
 #include <vector>
 
+#include "evaluate.h"
 #include "material.h"
 #include "movepick.h"
 #include "pawns.h"
@@ -50,15 +54,23 @@ class Thread {
 public:
   explicit Thread(size_t);
   virtual ~Thread();
+  static void* operator new(size_t size);
+  static void operator delete(void* ptr);
   virtual void search();
+  void batch_search();
   void clear();
+  void size_eval_tables();
   void idle_loop();
   void start_searching();
   void wait_for_search_finished();
   size_t id() const { return idx; }
 
   Pawns::Table pawnsTable;
+  Pawns::Entry pawnlessEntry{}; // Used instead of the table in variants without pawns
+  bool pawnless = false;
   Material::Table materialTable;
+  Eval::Cache evalCache;
+  bool useEvalCache = false;
   size_t pvIdx, pvLast;
   uint64_t ttHitAverage;
   int selDepth, nmpMinPly;
@@ -69,6 +81,7 @@ public:
   StateInfo rootState;
   Search::RootMoves rootMoves;
   Depth rootDepth, completedDepth;
+  int rootPlies; // Plies since the previous root, by which lowPlyHistory is shifted
   CounterMoveHistory counterMoves;
   ButterflyHistory mainHistory;
   LowPlyHistory lowPlyHistory;
@@ -92,11 +105,85 @@ struct MainThread : public Thread {
   Value iterValue[4];
   int callsCnt;
   bool stopOnPonderhit;
+  bool pvDropped;
   std::atomic_bool ponder;
   Thread* bestThread; // to fetch best move when in XBoard mode
 };
 
 
+/// BatchJob is the base of jobs where every thread works on its own positions
+/// independently of the other threads (root parallelism), e.g. the analysis of
+/// a set of positions. Limits apply to the searches of all threads alike.
+
+struct BatchJob {
+
+  virtual ~BatchJob() = default;
+  virtual void run(Thread& th) = 0;
+
+  int64_t nodes = 0; // Stop after the first iteration exceeding this many nodes
+};
+
+
+/// BatchAnalysis takes FENs from the shared input and reports the results of
+/// their searches as soon as they are finished.
+
+struct BatchAnalysis : public BatchJob {
+
+  BatchAnalysis(const Variant* v, bool c960, std::istream& i, std::ostream& o)
+    : variant(v), chess960(c960), in(i), out(o) {}
+
+  void run(Thread& th) override;
+  bool next(std::string& fen);
+  void report(Thread& th, const std::string& fen);
+
+  const Variant* variant;
+  bool chess960;
+  size_t done = 0, invalid = 0;
+
+private:
+  std::istream& in;
+  std::ostream& out;
+  std::mutex mutex;
+};
+
+
+/// GoLatency measures the latency of 'go' commands, until all threads have set
+/// up their root position and until the first info line is sent.
+
+struct GoLatency {
+
+  void start();
+  void thread_ready(size_t threadCount);
+  void info_sent();
+
+  std::atomic<uint64_t> count{0}, setupTime{0}, infoTime{0}; // In microseconds
+
+private:
+  std::chrono::steady_clock::time_point startTime;
+  std::atomic<size_t> readyThreads{0};
+  std::atomic_bool infoPending{false};
+};
+
+
+/// SearchContinuation keeps the result of the last search, so that a search
+/// whose root lies on the PV of the previous one can continue from it: the
+/// root moves keep their order and scores, and iterative deepening resumes at
+/// the depth the previous search has already covered.
+
+struct SearchContinuation {
+
+  void save(Position& pos, const Search::RootMoves& rms, Depth d);
+  int plies_to(Key key) const;
+  Depth restore(Search::RootMoves& rms, int plies, size_t multiPV) const;
+  void clear() { keys.clear(); }
+
+private:
+  std::vector<Key> keys; // Keys of the previous root and of the positions along its PV
+  Search::RootMoves rootMoves;
+  Depth depth = 0;
+};
+
+
 /// ThreadPool struct handles all the threads-related stuff like init, starting,
 /// parking and, most importantly, launching a thread. All the access to threads
 /// is done through this class.
@@ -104,6 +191,7 @@ struct MainThread : public Thread {
 struct ThreadPool : public std::vector<Thread*> {
 
   void start_thinking(Position&, StateListPtr&, const Search::LimitsType&, bool = false);
+  void run_batch(BatchJob&, const Search::LimitsType&);
   void clear();
   void set(size_t);
 
@@ -118,6 +206,14 @@ struct ThreadPool : public std::vector<Thread*> {
   std::atomic_bool abort, sit;
 
   StateListPtr setupStates;
+  BatchJob* batch = nullptr;
+  GoLatency latency;
+  SearchContinuation continuation;
+
+  // Snapshot of the root, from which every thread sets up its own copy
+  Position rootPos;
+  StateInfo rootState;
+  Search::RootMoves rootMoves;
 
 private:
   uint64_t accumulate(std::atomic<uint64_t> Thread::* member) const {
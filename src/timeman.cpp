@@ -19,8 +19,14 @@
 #include <algorithm>
 #include <cfloat>
 #include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
 
 #include "partner.h"
+#include "position.h"
 #include "search.h"
 #include "timeman.h"
 #include "uci.h"
@@ -37,13 +43,7 @@ TimeManagement Time; // Our global time management object
 
 void TimeManagement::init(const Position& pos, Search::LimitsType& limits, Color us, int ply) {
 
-  TimePoint moveOverhead    = TimePoint(Options["Move Overhead"]);
-  TimePoint slowMover       = TimePoint(Options["Slow Mover"]);
-  TimePoint npmsec          = TimePoint(Options["nodestime"]);
-
-  // optScale is a percentage of available time to use for the current move.
-  // maxScale is a multiplier applied to optimumTime.
-  double optScale, maxScale;
+  TimePoint npmsec = TimePoint(Options["nodestime"]);
 
   // If we have to play in 'nodes as time' mode, then convert from time
   // to nodes, and use resulting values in time management formulas.
@@ -61,6 +61,33 @@ void TimeManagement::init(const Position& pos, Search::LimitsType& limits, Color
   }
 
   startTime = limits.startTime;
+  iterations.clear();
+  stopReason = "other";
+
+  inputs.moveOverhead   = TimePoint(Options["Move Overhead"]);
+  inputs.slowMover      = TimePoint(Options["Slow Mover"]);
+  inputs.ponder         = Options["Ponder"];
+  inputs.twoBoards      = pos.two_boards();
+  inputs.partnerDead    = Partner.partnerDead;
+  inputs.partnerFast    = Partner.fast;
+  inputs.partnerOppTime = Partner.opptime;
+  inputs.partnerIncoming = Partner.expected_value(us) - Partner.expected_value(~us);
+
+  allocate(inputs, limits, us, ply);
+}
+
+
+/// TimeManagement::allocate() computes the optimum and maximum time of the
+/// move from the search limits, which are already converted to nodes in
+/// 'nodes as time' mode. It is also used to replay logged decisions.
+
+void TimeManagement::allocate(const TimeInputs& in, const Search::LimitsType& limits, Color us, int ply) {
+
+  TimePoint moveOverhead = in.moveOverhead;
+
+  // optScale is a percentage of available time to use for the current move.
+  // maxScale is a multiplier applied to optimumTime.
+  double optScale, maxScale;
 
   // Maximum move horizon of 50 moves
   int mtg = limits.movestogo ? std::min(limits.movestogo, 50) : 50;
@@ -70,21 +97,26 @@ void TimeManagement::init(const Position& pos, Search::LimitsType& limits, Color
       limits.time[us] + limits.inc[us] * (mtg - 1) - moveOverhead * (2 + mtg));
 
   // Adjust time management for four-player variants
-  if (pos.two_boards())
+  if (in.twoBoards)
   {
-      if (Partner.partnerDead && Partner.opptime)
-          timeLeft -= Partner.opptime;
+      if (in.partnerDead && in.partnerOppTime)
+          timeLeft -= in.partnerOppTime;
       else
       {
-          timeLeft = std::min(timeLeft, 5000 + std::min(std::abs(limits.time[us] - Partner.opptime), TimePoint(Partner.opptime)));
-          if (Partner.fast || Partner.partnerDead)
+          timeLeft = std::min(timeLeft, 5000 + std::min(std::abs(limits.time[us] - in.partnerOppTime), in.partnerOppTime));
+          if (in.partnerFast || in.partnerDead)
               timeLeft /= 4;
+
+          // Take up to a quarter more time while a piece is on its way to us,
+          // and up to a quarter less while one is on its way to the opponent
+          int incoming = std::clamp(int(in.partnerIncoming), -int(QueenValueMg), int(QueenValueMg));
+          timeLeft += timeLeft * incoming / (4 * int(QueenValueMg));
       }
   }
 
   // A user may scale time usage by setting UCI option "Slow Mover"
   // Default is 100 and changing this value will probably lose elo.
-  timeLeft = slowMover * timeLeft / 100;
+  timeLeft = in.slowMover * timeLeft / 100;
 
   // x basetime (+ z increment)
   // If there is a healthy increment, timeLeft can exceed actual available
@@ -108,8 +140,247 @@ void TimeManagement::init(const Position& pos, Search::LimitsType& limits, Color
   optimumTime = TimePoint(optScale * timeLeft);
   maximumTime = TimePoint(std::min(0.8 * limits.time[us] - moveOverhead, maxScale * optimumTime));
 
-  if (Options["Ponder"])
+  if (in.ponder)
       optimumTime += optimumTime / 4;
 }
 
+
+namespace {
+
+  std::ofstream timeLog;
+
+} // namespace
+
+
+/// start_time_log() opens the file the time decisions are appended to, an
+/// empty file name stops the logging.
+
+void start_time_log(const std::string& fname) {
+
+  if (timeLog.is_open())
+      timeLog.close();
+
+  if (!fname.empty())
+  {
+      timeLog.open(fname, std::ifstream::out | std::ifstream::app);
+      if (!timeLog.is_open())
+          sync_cout << "info string Unable to open time log file " << fname << sync_endl;
+  }
+
+  Time.logEnabled = timeLog.is_open();
+}
+
+
+/// TimeManagement::log_move() writes a line with the inputs, the allocated
+/// times, the iterations and the outcome of the search of a move. The line
+/// contains everything needed by replay_time_log() to recompute the decisions:
+///
+/// move variant=crazyhouse ply=12 us=w time=60000 inc=0 mtg=0 npmsec=0 overhead=10
+///      slowmover=100 ponder=0 twoboards=0 partnerdead=0 partnerfast=0 opptime=0
+///      incoming=0 optimum=1500 maximum=6000 moves=30 iter=1:2:1.02:0.87:1.07:0 ...
+///      elapsed=1540 depth=16 stop=optimum
+
+void TimeManagement::log_move(const Position& pos, const Search::LimitsType& limits, Depth depth) {
+
+  if (!timeLog.is_open())
+      return;
+
+  Color us = pos.side_to_move();
+  std::stringstream ss;
+
+  ss << "move variant=" << std::string(Options["UCI_Variant"])
+     << " ply=" << pos.game_ply()
+     << " us=" << (us == WHITE ? 'w' : 'b')
+     << " time=" << limits.time[us]
+     << " inc=" << limits.inc[us]
+     << " mtg=" << limits.movestogo
+     << " npmsec=" << limits.npmsec
+     << " overhead=" << inputs.moveOverhead
+     << " slowmover=" << inputs.slowMover
+     << " ponder=" << inputs.ponder
+     << " twoboards=" << inputs.twoBoards
+     << " partnerdead=" << inputs.partnerDead
+     << " partnerfast=" << inputs.partnerFast
+     << " opptime=" << inputs.partnerOppTime
+     << " incoming=" << inputs.partnerIncoming
+     << " optimum=" << optimumTime
+     << " maximum=" << maximumTime
+     << " moves=" << pos.this_thread()->rootMoves.size()
+     << std::setprecision(4);
+
+  for (const TimeIteration& it : iterations)
+      ss << " iter=" << it.depth << ':' << it.elapsed << ':' << it.fallingEval << ':'
+         << it.reduction << ':' << it.instability << ':' << it.bestMoveChanges;
+
+  ss << " elapsed=" << elapsed()
+     << " depth=" << depth
+     << " stop=" << stopReason << '\n';
+
+  timeLog << ss.str() << std::flush;
+}
+
+
+/// replay_time_log() is called when engine receives the "timereplay" command.
+/// The time management policy with the current options is applied to the moves
+/// of a time log, and the resulting time usage is compared to the logged one.
+/// The stop decision of every logged iteration is reevaluated against the new
+/// optimum and maximum time. When the new policy would have searched past the
+/// last logged iteration, the search is assumed to run until the maximum time.
+/// Clocks are carried over from move to move, so that the replay shows which
+/// games would have been lost on time.
+///
+/// timereplay file=time.log
+
+void replay_time_log(std::istream& is) {
+
+  std::string token, fname = "time.log";
+
+  while (is >> token)
+      if (token.find("file=") == 0)
+          fname = token.substr(5);
+
+  std::ifstream file(fname);
+  if (!file.is_open())
+  {
+      sync_cout << "info string Unable to open file " << fname << sync_endl;
+      return;
+  }
+
+  TimeInputs current;
+  current.moveOverhead = TimePoint(Options["Move Overhead"]);
+  current.slowMover    = TimePoint(Options["Slow Mover"]);
+
+  TimeManagement tm;
+  int lastPly = -1, moves = 0, extrapolated = 0, loggedFlags = 0, replayedFlags = 0;
+  TimePoint loggedTotal = 0, replayedTotal = 0, saved[COLOR_NB] = {};
+  int64_t loggedDepth = 0, replayedDepth = 0;
+
+  for (std::string line; std::getline(file, line); )
+  {
+      std::istringstream ls(line);
+      if (!(ls >> token) || token != "move")
+          continue;
+
+      Search::LimitsType limits;
+      TimeInputs logged = {};
+      std::vector<TimeIteration> iters;
+      Color us = WHITE;
+      int ply = 0, rootMoveCount = 0;
+      TimePoint used = 0, optimum = 0, maximum = 0;
+      Depth depth = 0;
+      std::string stop;
+
+      while (ls >> token)
+      {
+          size_t eq = token.find('=');
+          std::string key = token.substr(0, eq), value = eq == std::string::npos ? "" : token.substr(eq + 1);
+          long long v = std::atoll(value.c_str());
+
+          if      (key == "ply")         ply = int(v);
+          else if (key == "us")          us = value == "b" ? BLACK : WHITE;
+          else if (key == "time")        limits.time[us] = v;
+          else if (key == "inc")         limits.inc[us] = v;
+          else if (key == "mtg")         limits.movestogo = int(v);
+          else if (key == "overhead")    logged.moveOverhead = v;
+          else if (key == "slowmover")   logged.slowMover = v;
+          else if (key == "ponder")      logged.ponder = v;
+          else if (key == "twoboards")   logged.twoBoards = v;
+          else if (key == "partnerdead") logged.partnerDead = v;
+          else if (key == "partnerfast") logged.partnerFast = v;
+          else if (key == "opptime")     logged.partnerOppTime = v;
+          else if (key == "incoming")    logged.partnerIncoming = Value(v);
+          else if (key == "optimum")     optimum = v;
+          else if (key == "maximum")     maximum = v;
+          else if (key == "moves")       rootMoveCount = int(v);
+          else if (key == "elapsed")     used = v;
+          else if (key == "depth")       depth = Depth(v);
+          else if (key == "stop")        stop = value;
+          else if (key == "iter")
+          {
+              TimeIteration it;
+              char sep;
+              std::istringstream vs(value);
+              vs >> it.depth >> sep >> it.elapsed >> sep >> it.fallingEval >> sep
+                 >> it.reduction >> sep >> it.instability >> sep >> it.bestMoveChanges;
+              iters.push_back(it);
+          }
+      }
+
+      // A new game starts whenever the ply count does not increase
+      if (ply <= lastPly)
+          saved[WHITE] = saved[BLACK] = 0;
+      lastPly = ply;
+
+      // The clock of the replayed game differs by the time saved so far
+      TimePoint loggedClock = limits.time[us];
+      limits.time[us] = std::max(TimePoint(1), loggedClock + saved[us]);
+
+      TimeInputs in = logged;
+      in.moveOverhead = current.moveOverhead;
+      in.slowMover = current.slowMover;
+      tm.allocate(in, limits, us, ply);
+
+      // Find the iteration after which the new policy stops
+      TimePoint newUsed = tm.maximum();
+      Depth newDepth = 0;
+      bool found = false;
+      for (const TimeIteration& it : iters)
+      {
+          if (it.elapsed > tm.maximum())
+          {
+              newUsed = tm.maximum();
+              found = true;
+              break;
+          }
+          newDepth = it.depth;
+          double totalTime = tm.optimum() * it.factor();
+          if (rootMoveCount == 1)
+              totalTime = std::min(500.0, totalTime);
+          if (it.elapsed > totalTime)
+          {
+              newUsed = it.elapsed;
+              found = true;
+              break;
+          }
+      }
+
+      // Searches not stopped by the time management keep their outcome
+      if (!found && stop != "optimum" && stop != "maximum")
+          newUsed = std::min(used, tm.maximum()), newDepth = depth;
+      else if (!found)
+          extrapolated++;
+
+      saved[us] += used - newUsed;
+      moves++;
+      loggedTotal += used;
+      replayedTotal += newUsed;
+      loggedDepth += depth;
+      replayedDepth += newDepth;
+      loggedFlags += used + logged.moveOverhead >= loggedClock;
+      replayedFlags += newUsed + in.moveOverhead >= limits.time[us];
+
+      sync_cout << "ply " << ply
+                << " clock " << loggedClock << " -> " << limits.time[us]
+                << " optimum " << optimum << " -> " << tm.optimum()
+                << " maximum " << maximum << " -> " << tm.maximum()
+                << " used " << used << " -> " << newUsed
+                << " depth " << depth << " -> " << newDepth
+                << (newUsed + in.moveOverhead >= limits.time[us] ? " flag" : "") << sync_endl;
+  }
+
+  if (!moves)
+  {
+      sync_cout << "info string No moves found in " << fname << sync_endl;
+      return;
+  }
+
+  sync_cout << "\nMoves           : " << moves
+            << "\nTime used       : " << loggedTotal << " -> " << replayedTotal
+            << "\nAverage depth   : " << std::fixed << std::setprecision(2)
+                                      << double(loggedDepth) / moves << " -> "
+                                      << double(replayedDepth) / moves
+            << "\nFlags           : " << loggedFlags << " -> " << replayedFlags
+            << "\nExtrapolated    : " << extrapolated << sync_endl;
+}
+
 } // namespace Stockfish
@@ -19,33 +19,74 @@
 #ifndef TIMEMAN_H_INCLUDED
 #define TIMEMAN_H_INCLUDED
 
+#include <istream>
+#include <string>
+#include <vector>
+
 #include "misc.h"
 #include "search.h"
 #include "thread.h"
 
 namespace Stockfish {
 
+/// TimeInputs are the parameters of the time allocation besides the search
+/// limits: the UCI options and the clock information of the bughouse partner.
+
+struct TimeInputs {
+  TimePoint moveOverhead, slowMover;
+  bool ponder, twoBoards, partnerDead, partnerFast;
+  TimePoint partnerOppTime;
+  Value partnerIncoming; // Value of the piece expected from the partner board, negative if for the opponent
+};
+
+
+/// TimeIteration stores the factors of the decision to stop the search after
+/// an iteration, the search stops when elapsed > optimum * factor().
+
+struct TimeIteration {
+  double factor() const { return fallingEval * reduction * instability; }
+
+  Depth depth;
+  TimePoint elapsed;
+  double fallingEval, reduction, instability, bestMoveChanges;
+};
+
+
 /// The TimeManagement class computes the optimal time to think depending on
 /// the maximum available time, the game move number and other parameters.
 
 class TimeManagement {
 public:
   void init(const Position& pos, Search::LimitsType& limits, Color us, int ply);
+  void allocate(const TimeInputs& in, const Search::LimitsType& limits, Color us, int ply);
   TimePoint optimum() const { return optimumTime; }
   TimePoint maximum() const { return maximumTime; }
   TimePoint elapsed() const { return Search::Limits.npmsec ?
                                      TimePoint(Threads.nodes_searched()) : now() - startTime; }
 
+  // Time decision log, see the "Time Log" option
+  bool logging() const { return logEnabled; }
+  void log_iteration(const TimeIteration& it) { iterations.push_back(it); }
+  void log_stop(const char* reason) { stopReason = reason; }
+  void log_move(const Position& pos, const Search::LimitsType& limits, Depth depth);
+
   int64_t availableNodes; // When in 'nodes as time' mode
+  bool logEnabled = false;
 
 private:
   TimePoint startTime;
   TimePoint optimumTime;
   TimePoint maximumTime;
+  TimeInputs inputs;
+  std::vector<TimeIteration> iterations;
+  const char* stopReason;
 };
 
 extern TimeManagement Time;
 
+void start_time_log(const std::string& fname);
+void replay_time_log(std::istream& is);
+
 } // namespace Stockfish
 
 #endif // #ifndef TIMEMAN_H_INCLUDED
@@ -17,11 +17,22 @@
 */
 
 #include <cstring>   // For std::memset
+#include <iomanip>
 #include <iostream>
+#include <sstream>
 #include <thread>
 
+#if !defined(_WIN32) && !defined(__ANDROID__) && !defined(__EMSCRIPTEN__)
+#define USE_SHARED_TT
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 #include "bitboard.h"
 #include "misc.h"
+#include "position.h"
 #include "thread.h"
 #include "tt.h"
 #include "uci.h"
@@ -64,11 +75,26 @@ void TranspositionTable::resize(size_t mbSize) {
 
   Threads.main()->wait_for_search_finished();
 
-  aligned_large_pages_free(table);
+  release();
 
   clusterCount = mbSize * 1024 * 1024 / sizeof(Cluster);
 
-  table = static_cast<Cluster*>(aligned_large_pages_alloc(clusterCount * sizeof(Cluster)));
+  // The segment name encodes everything that determines the meaning of an
+  // entry, so that only compatible processes end up sharing a table.
+  std::string sharedName = Options["Shared Hash"];
+  if (sharedName != "<empty>" && !sharedName.empty())
+  {
+      std::stringstream ss;
+      ss << "/" << sharedName << "-" << std::string(Options["UCI_Variant"])
+         << "-" << std::hex << Zobrist::side << std::dec << "-" << mbSize;
+      if (attach_shared(ss.str(), clusterCount * sizeof(Cluster)))
+          return;
+
+      sync_cout << "info string Failed to attach shared hash " << ss.str()
+                << ", using a private table" << sync_endl;
+  }
+
+  table = static_cast<Cluster*>(aligned_large_pages_alloc(clusterCount * sizeof(Cluster), "TT"));
   if (!table)
   {
       std::cerr << "Failed to allocate " << mbSize
@@ -80,11 +106,74 @@ void TranspositionTable::resize(size_t mbSize) {
 }
 
 
+/// TranspositionTable::attach_shared() maps the named POSIX shared memory segment
+/// as the table, creating it if it does not exist yet. A newly created segment
+/// is zero-filled by the kernel, so it does not need to be cleared.
+
+bool TranspositionTable::attach_shared(const std::string& name, size_t size) {
+
+#if defined(USE_SHARED_TT)
+  int fd = shm_open(name.c_str(), O_RDWR | O_CREAT, 0600);
+  if (fd == -1)
+      return false;
+
+  // Only grow the segment, another process might already be using it
+  struct stat sb;
+  if (fstat(fd, &sb) == -1 || (size_t(sb.st_size) < size && ftruncate(fd, off_t(size)) == -1))
+  {
+      close(fd);
+      return false;
+  }
+
+  void* mem = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (mem == MAP_FAILED)
+      return false;
+
+#if defined(MADV_HUGEPAGE)
+  madvise(mem, size, MADV_HUGEPAGE);
+#endif
+
+  table = static_cast<Cluster*>(mem);
+  sharedSize = size;
+  return true;
+#else
+  (void)name;
+  (void)size;
+  return false;
+#endif
+}
+
+
+/// TranspositionTable::release() frees the table, unmapping it if it is shared.
+/// The shared segment itself persists for other and later engine processes.
+
+void TranspositionTable::release() {
+
+#if defined(USE_SHARED_TT)
+  if (sharedSize)
+  {
+      munmap(table, sharedSize);
+      table = nullptr;
+      sharedSize = 0;
+      return;
+  }
+#endif
+
+  aligned_large_pages_free(table);
+  table = nullptr;
+}
+
+
 /// TranspositionTable::clear() initializes the entire transposition table to zero,
-//  in a multi-threaded way.
+//  in a multi-threaded way. A shared table is left alone, since its content is
+//  owned by all attached processes.
 
 void TranspositionTable::clear() {
 
+  if (sharedSize)
+      return;
+
   std::vector<std::thread> threads;
 
   for (size_t idx = 0; idx < Options["Threads"]; ++idx)
@@ -61,7 +61,9 @@ private:
 /// cluster consists of ClusterSize number of TTEntry. Each non-empty TTEntry
 /// contains information on exactly one position. The size of a Cluster should
 /// divide the size of a cache line for best performance, as the cacheline is
-/// prefetched when possible.
+/// prefetched when possible. Optionally the table lives in a named shared memory
+/// segment, so that several engine processes analysing the same variant can
+/// attach to it and reuse each other's entries.
 
 class TranspositionTable {
 
@@ -81,12 +83,13 @@ class TranspositionTable {
   static constexpr int      GENERATION_MASK  = (0xFF << GENERATION_BITS) & 0xFF; // mask to pull out generation number
 
 public:
- ~TranspositionTable() { aligned_large_pages_free(table); }
+ ~TranspositionTable() { release(); }
   void new_search() { generation8 += GENERATION_DELTA; } // Lower bits are used for other things
   TTEntry* probe(const Key key, bool& found) const;
   int hashfull() const;
   void resize(size_t mbSize);
   void clear();
+  bool is_shared() const { return sharedSize; }
 
   TTEntry* first_entry(const Key key) const {
     return &table[mul_hi64(key, clusterCount)].entry[0];
@@ -95,8 +98,12 @@ public:
 private:
   friend struct TTEntry;
 
+  bool attach_shared(const std::string& name, size_t size);
+  void release();
+
   size_t clusterCount;
   Cluster* table;
+  size_t sharedSize; // Size of the mapped shared memory segment, zero if private
   uint8_t generation8; // Size must be not bigger than TTEntry::genBound8
 };
 
@@ -19,6 +19,7 @@
 #include <cstdlib>
 #include <cassert>
 #include <cmath>
+#include <fstream>
 #include <iostream>
 #include <sstream>
 #include <string>
@@ -39,44 +40,96 @@ using namespace std;
 namespace Stockfish {
 
 extern vector<string> setup_bench(const Position&, istream&);
+extern void gensfen(istream&);
+extern void serve(istream&);
 
-namespace {
+namespace UCI {
 
-  // position() is called when engine receives the "position" UCI command.
-  // The function sets up the position described in the given FEN string ("fen")
-  // or the starting position ("startpos") and then makes the moves given in the
-  // following move list ("moves").
+/// UCI::position() is called when engine receives the "position" UCI command.
+/// The function sets up the position described in the given FEN string ("fen")
+/// or the starting position ("startpos") and then makes the moves given in the
+/// following move list ("moves").
 
-  void position(Position& pos, istringstream& is, StateListPtr& states) {
+void position(Position& pos, istream& is, StateListPtr& states) {
 
-    Move m;
-    string token, fen;
+  Move m;
+  string token, fen;
 
-    is >> token;
-    // Parse as SFEN if specified
-    bool sfen = token == "sfen";
+  is >> token;
+  // Parse as SFEN if specified
+  bool sfen = token == "sfen";
 
-    if (token == "startpos")
-    {
-        fen = variants.find(Options["UCI_Variant"])->second->startFen;
-        is >> token; // Consume "moves" token if any
-    }
-    else if (token == "fen" || token == "sfen")
-        while (is >> token && token != "moves")
-            fen += token + " ";
-    else
-        return;
+  if (token == "startpos")
+  {
+      fen = variants.find(Options["UCI_Variant"])->second->startFen;
+      is >> token; // Consume "moves" token if any
+  }
+  else if (token == "fen" || token == "sfen")
+      while (is >> token && token != "moves")
+          fen += token + " ";
+  else
+      return;
 
-    states = StateListPtr(new std::deque<StateInfo>(1)); // Drop old and create a new one
-    pos.set(variants.find(Options["UCI_Variant"])->second, fen, Options["UCI_Chess960"], &states->back(), Threads.main(), sfen);
+  states = StateListPtr(new std::deque<StateInfo>(1)); // Drop old and create a new one
+  pos.set(variants.find(Options["UCI_Variant"])->second, fen, Options["UCI_Chess960"], &states->back(), Threads.main(), sfen);
 
-    // Parse move list (if any)
-    while (is >> token && (m = UCI::to_move(pos, token)) != MOVE_NONE)
-    {
-        states->emplace_back();
-        pos.do_move(m, states->back());
-    }
+  // Parse move list (if any)
+  while (is >> token && (m = UCI::to_move(pos, token)) != MOVE_NONE)
+  {
+      states->emplace_back();
+      pos.do_move(m, states->back());
   }
+}
+
+
+/// UCI::parse_limits() parses the arguments of the "go" command into the given
+/// search limits and returns whether the search is to be started in ponder mode.
+
+bool parse_limits(const Position& pos, istream& is, Search::LimitsType& limits) {
+
+  string token;
+  bool ponderMode = false;
+  bool isUsi = CurrentProtocol == USI;
+  int secResolution = Options["usemillisec"] ? 1 : 1000;
+
+  while (is >> token)
+      if (token == "searchmoves") // Needs to be the last command on the line
+          while (is >> token)
+              limits.searchmoves.push_back(UCI::to_move(pos, token));
+
+      else if (token == "wtime")     is >> limits.time[isUsi ? BLACK : WHITE];
+      else if (token == "btime")     is >> limits.time[isUsi ? WHITE : BLACK];
+      else if (token == "winc")      is >> limits.inc[isUsi ? BLACK : WHITE];
+      else if (token == "binc")      is >> limits.inc[isUsi ? WHITE : BLACK];
+      else if (token == "movestogo") is >> limits.movestogo;
+      else if (token == "depth")     is >> limits.depth;
+      else if (token == "nodes")     is >> limits.nodes;
+      else if (token == "movetime")  is >> limits.movetime;
+      else if (token == "mate")      is >> limits.mate;
+      else if (token == "perft")     is >> limits.perft;
+      else if (token == "infinite")  limits.infinite = 1;
+      else if (token == "ponder")    ponderMode = true;
+      // UCCI commands
+      else if (token == "time")         is >> limits.time[pos.side_to_move()], limits.time[pos.side_to_move()] *= secResolution;
+      else if (token == "opptime")      is >> limits.time[~pos.side_to_move()], limits.time[~pos.side_to_move()] *= secResolution;
+      else if (token == "increment")    is >> limits.inc[pos.side_to_move()], limits.inc[pos.side_to_move()] *= secResolution;
+      else if (token == "oppincrement") is >> limits.inc[~pos.side_to_move()], limits.inc[~pos.side_to_move()] *= secResolution;
+      // USI commands
+      else if (token == "byoyomi")
+      {
+          int byoyomi = 0;
+          is >> byoyomi;
+          limits.inc[WHITE] = limits.inc[BLACK] = byoyomi;
+          limits.time[WHITE] += byoyomi;
+          limits.time[BLACK] += byoyomi;
+      }
+
+  return ponderMode;
+}
+
+} // namespace UCI
+
+namespace {
 
   // trace_eval() prints the evaluation for the current position, consistent with the UCI
   // options set so far.
@@ -130,46 +183,11 @@ namespace {
   void go(Position& pos, istringstream& is, StateListPtr& states, const std::vector<Move>& banmoves = {}) {
 
     Search::LimitsType limits;
-    string token;
-    bool ponderMode = false;
 
     limits.startTime = now(); // As early as possible!
 
     limits.banmoves = banmoves;
-    bool isUsi = CurrentProtocol == USI;
-    int secResolution = Options["usemillisec"] ? 1 : 1000;
-
-    while (is >> token)
-        if (token == "searchmoves") // Needs to be the last command on the line
-            while (is >> token)
-                limits.searchmoves.push_back(UCI::to_move(pos, token));
-
-        else if (token == "wtime")     is >> limits.time[isUsi ? BLACK : WHITE];
-        else if (token == "btime")     is >> limits.time[isUsi ? WHITE : BLACK];
-        else if (token == "winc")      is >> limits.inc[isUsi ? BLACK : WHITE];
-        else if (token == "binc")      is >> limits.inc[isUsi ? WHITE : BLACK];
-        else if (token == "movestogo") is >> limits.movestogo;
-        else if (token == "depth")     is >> limits.depth;
-        else if (token == "nodes")     is >> limits.nodes;
-        else if (token == "movetime")  is >> limits.movetime;
-        else if (token == "mate")      is >> limits.mate;
-        else if (token == "perft")     is >> limits.perft;
-        else if (token == "infinite")  limits.infinite = 1;
-        else if (token == "ponder")    ponderMode = true;
-        // UCCI commands
-        else if (token == "time")         is >> limits.time[pos.side_to_move()], limits.time[pos.side_to_move()] *= secResolution;
-        else if (token == "opptime")      is >> limits.time[~pos.side_to_move()], limits.time[~pos.side_to_move()] *= secResolution;
-        else if (token == "increment")    is >> limits.inc[pos.side_to_move()], limits.inc[pos.side_to_move()] *= secResolution;
-        else if (token == "oppincrement") is >> limits.inc[~pos.side_to_move()], limits.inc[~pos.side_to_move()] *= secResolution;
-        // USI commands
-        else if (token == "byoyomi")
-        {
-            int byoyomi = 0;
-            is >> byoyomi;
-            limits.inc[WHITE] = limits.inc[BLACK] = byoyomi;
-            limits.time[WHITE] += byoyomi;
-            limits.time[BLACK] += byoyomi;
-        }
+    bool ponderMode = UCI::parse_limits(pos, is, limits);
 
     Threads.start_thinking(pos, states, limits, ponderMode);
   }
@@ -187,6 +205,7 @@ namespace {
     num = count_if(list.begin(), list.end(), [](string s) { return s.find("go ") == 0 || s.find("eval") == 0; });
 
     TimePoint elapsed = now();
+    uint64_t goCount = Threads.latency.count, setupTime = Threads.latency.setupTime, infoTime = Threads.latency.infoTime;
 
     for (const auto& cmd : list)
     {
@@ -206,7 +225,7 @@ namespace {
                trace_eval(pos);
         }
         else if (token == "setoption")  setoption(is);
-        else if (token == "position")   position(pos, is, states);
+        else if (token == "position")   UCI::position(pos, is, states);
         else if (token == "ucinewgame") { Search::clear(); elapsed = now(); } // Search::clear() may take some while
     }
 
@@ -217,7 +236,84 @@ namespace {
     cerr << "\n==========================="
          << "\nTotal time (ms) : " << elapsed
          << "\nNodes searched  : " << nodes
-         << "\nNodes/second    : " << 1000 * nodes / elapsed << endl;
+         << "\nNodes/second    : " << 1000 * nodes / elapsed;
+
+    // Hit rates of the evaluation tables of all threads since the new game
+    uint64_t pawnProbes = 0, pawnHits = 0, materialProbes = 0, materialHits = 0, evalProbes = 0, evalHits = 0;
+    for (Thread* th : Threads)
+    {
+        pawnProbes += th->pawnsTable.probes, pawnHits += th->pawnsTable.hits;
+        materialProbes += th->materialTable.probes, materialHits += th->materialTable.hits;
+        evalProbes += th->evalCache.probes, evalHits += th->evalCache.hits;
+    }
+    cerr << "\nPawn table hits : " << 100 * pawnHits / std::max(pawnProbes, uint64_t(1)) << "%"
+         << "\nMaterial hits   : " << 100 * materialHits / std::max(materialProbes, uint64_t(1)) << "%";
+    if (evalProbes)
+        cerr << "\nEval cache hits : " << 100.0 * evalHits / evalProbes << "%";
+
+    // Average latency of the 'go' commands until search start and first info
+    if ((goCount = Threads.latency.count - goCount))
+        cerr << "\nGo setup (us)   : " << (Threads.latency.setupTime - setupTime) / goCount
+             << "\nFirst info (us) : " << (Threads.latency.infoTime - infoTime) / goCount;
+
+    cerr << endl;
+  }
+
+  // analyse() is called when engine receives the "analyse" command. The positions
+  // of an EPD/FEN file are searched independently and in parallel, one per thread,
+  // which scales much better than searching each of them with all threads.
+  // Results are written as EPD lines in the order the searches finish.
+  //
+  // analyse file=positions.epd depth=12 out=results.epd
+
+  void analyse(istringstream& is) {
+
+    Search::LimitsType limits;
+    string token, inFile, outFile;
+    int64_t nodes = 0;
+
+    while (is >> token)
+    {
+        size_t eq = token.find('=');
+        string key = token.substr(0, eq), value = eq == string::npos ? "" : token.substr(eq + 1);
+
+        if (key == "file")       inFile = value;
+        else if (key == "out")   outFile = value;
+        else if (key == "depth") limits.depth = std::atoi(value.c_str());
+        else if (key == "nodes") nodes = std::atoll(value.c_str());
+    }
+
+    if (!limits.depth && !nodes)
+        limits.depth = 10;
+
+    ifstream in(inFile);
+    if (!in.is_open())
+    {
+        sync_cout << "info string Unable to open file " << inFile << sync_endl;
+        return;
+    }
+
+    ofstream file;
+    if (!outFile.empty())
+    {
+        file.open(outFile);
+        if (!file.is_open())
+        {
+            sync_cout << "info string Unable to open file " << outFile << sync_endl;
+            return;
+        }
+    }
+
+    BatchAnalysis batch(variants.find(Options["UCI_Variant"])->second, Options["UCI_Chess960"],
+                        in, outFile.empty() ? cout : file);
+    batch.nodes = nodes;
+
+    TimePoint elapsed = now();
+    Threads.run_batch(batch, limits);
+    elapsed = now() - elapsed + 1;
+
+    sync_cout << "info string analysed " << batch.done << " positions in " << elapsed << " ms"
+              << (batch.invalid ? ", skipped " + std::to_string(batch.invalid) + " invalid FENs" : "") << sync_endl;
   }
 
   // The win rate model returns the probability (per mille) of winning given an eval
@@ -284,6 +380,128 @@ namespace {
     }
   }
 
+  // parse_square() reads a square written by UCI::square() starting at str[idx]
+  // and advances idx past it. Returns SQ_NONE if no square on the board is found.
+
+  Square parse_square(const Position& pos, const string& str, size_t& idx) {
+
+    auto number = [&](int maxDigits) {
+        int n = 0, digits = 0;
+        for ( ; idx < str.size() && digits < maxDigits && isdigit(str[idx]); ++digits)
+            n = 10 * n + (str[idx++] - '0');
+        return digits ? n : -1;
+    };
+
+    int f, r;
+    if (CurrentProtocol == USI)
+    {
+        int n = number(2);
+        if (n < 0 || idx >= str.size() || !islower(str[idx]))
+            return SQ_NONE;
+        f = pos.max_file() + 1 - n;
+        r = pos.max_rank() - (str[idx++] - 'a');
+    }
+    else
+    {
+        if (idx >= str.size() || !islower(str[idx]))
+            return SQ_NONE;
+        f = str[idx++] - 'a';
+#ifdef LARGEBOARDS
+        if (pos.max_rank() == RANK_10 && CurrentProtocol != UCI_GENERAL)
+            r = number(1);
+        else
+#endif
+            r = number(2) - 1;
+    }
+
+    return f >= 0 && f <= pos.max_file() && r >= 0 && r <= pos.max_rank() ? make_square(File(f), Rank(r)) : SQ_NONE;
+  }
+
+  // piece_type() maps a piece letter of the given color to its piece type
+  PieceType piece_type(const Position& pos, Color c, char token) {
+
+    size_t idx = pos.piece_to_char().find(token);
+    return idx != string::npos && color_of(Piece(idx)) == c ? type_of(Piece(idx)) : NO_PIECE_TYPE;
+  }
+
+  // decode_move() parses the fields of a move in coordinate notation directly
+  // into candidate moves and returns the one that is legal and prints back as
+  // the given string. Returns MOVE_NONE for notations it can not decode.
+
+  Move decode_move(const Position& pos, const string& str) {
+
+    Move candidates[6];
+    int cnt = 0;
+    size_t idx = 0;
+    size_t dropIdx = str.find_first_of("@*");
+
+    if (dropIdx != string::npos)
+    {
+        // Piece drop, with a '+' prefix when dropping as promoted piece
+        bool promoted = str[0] == '+';
+        if (dropIdx != 1 + size_t(promoted))
+            return MOVE_NONE;
+        PieceType pt = piece_type(pos, WHITE, str[dropIdx - 1]);
+        idx = dropIdx + 1;
+        Square to = parse_square(pos, str, idx);
+        if (!pt || to == SQ_NONE || idx != str.size())
+            return MOVE_NONE;
+        candidates[cnt++] = make_drop(to, pt, promoted ? pos.promoted_piece_type(pt) : pt);
+    }
+    else
+    {
+        Square from = parse_square(pos, str, idx);
+        Square to = parse_square(pos, str, idx);
+        if (from == SQ_NONE || to == SQ_NONE)
+            return MOVE_NONE;
+
+        PieceType pt = NO_PIECE_TYPE;
+        Square gate = from;
+        if (idx + 1 == str.size() && (str[idx] == '+' || str[idx] == '-'))
+            candidates[cnt++] = str[idx] == '+' ? make<PIECE_PROMOTION>(from, to) : make<PIECE_DEMOTION>(from, to);
+        else
+        {
+            if (idx < str.size())
+            {
+                // Promotion or gating, the latter optionally with a gating square
+                pt = piece_type(pos, BLACK, str[idx++]);
+                if (idx < str.size())
+                    gate = parse_square(pos, str, idx);
+                if (!pt || gate == SQ_NONE || idx != str.size())
+                    return MOVE_NONE;
+                if (gate == from)
+                    candidates[cnt++] = make<PROMOTION>(from, to, pt);
+                candidates[cnt++] = make_gating<NORMAL>(from, to, pt, gate);
+            }
+            else
+            {
+                candidates[cnt++] = make_move(from, to);
+                candidates[cnt++] = from == to ? make<SPECIAL>(from, to) : make<EN_PASSANT>(from, to);
+            }
+
+            // Castling is encoded as king captures rook,
+            // gating on the rook square swaps both squares.
+            for (CastlingRights cr : {pos.side_to_move() & KING_SIDE, pos.side_to_move() & QUEEN_SIDE})
+                if (pos.can_castle(cr))
+                {
+                    Square rsq = pos.castling_rook_square(cr);
+                    candidates[cnt++] = pt ? make_gating<CASTLING>(from, rsq, pt, gate) : make<CASTLING>(from, rsq);
+                    if (pt && from == rsq)
+                        candidates[cnt++] = make_gating<CASTLING>(to, rsq, pt, rsq);
+                }
+        }
+    }
+
+    for (int i = 0; i < cnt; ++i)
+        if (   pos.pseudo_legal(candidates[i])
+            && pos.legal(candidates[i])
+            && !pos.virtual_drop(candidates[i])
+            && UCI::move(pos, candidates[i]) == str)
+            return candidates[i];
+
+    return MOVE_NONE;
+  }
+
 } // namespace
 
 
@@ -384,6 +602,10 @@ void UCI::loop(int argc, char* argv[]) {
       // Do not use these commands during a search!
       else if (token == "flip")     pos.flip();
       else if (token == "bench")    bench(pos, is, states);
+      else if (token == "analyse")  analyse(is);
+      else if (token == "gensfen")  gensfen(is);
+      else if (token == "serve")    serve(is);
+      else if (token == "timereplay") replay_time_log(is);
       else if (token == "d")        sync_cout << pos << sync_endl;
       else if (token == "eval")     trace_eval(pos);
       else if (token == "compiler") sync_cout << compiler_info() << sync_endl;
@@ -414,6 +636,9 @@ void UCI::loop(int argc, char* argv[]) {
           sync_cout << "Unknown command: " << cmd << sync_endl;
 
   } while (token != "quit" && argc == 1); // Command line args are one-shot
+
+  // The search may still apply its move to the position in XBoard mode
+  Threads.main()->wait_for_search_finished();
 }
 
 
@@ -563,6 +788,14 @@ Move UCI::to_move(const Position& pos, string& str) {
           str[4] = char(tolower(str[4]));
   }
 
+  if (pos.is_immediate_game_end())
+      return MOVE_NONE;
+
+  // Most moves can be decoded directly, only resort to matching
+  // against the list of legal moves for the remaining ones.
+  if (Move m = decode_move(pos, str))
+      return m;
+
   for (const auto& m : MoveList<LEGAL>(pos))
       if (str == UCI::move(pos, m) || (is_pass(m) && str == UCI::square(pos, from_sq(m)) + UCI::square(pos, to_sq(m))))
           return m;
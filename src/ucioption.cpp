@@ -27,6 +27,7 @@
 #include "piece.h"
 #include "search.h"
 #include "thread.h"
+#include "timeman.h"
 #include "tt.h"
 #include "uci.h"
 #include "variant.h"
@@ -52,6 +53,10 @@ std::set<string> standard_variants = {
 };
 
 void init_variant(const Variant* v) {
+    // Piece definitions only need to be rebuilt when the variant changes. Variants
+    // are told apart by id, since a reloaded variant may get the address of a freed one.
+    if (v->id == pieceMap.variantId)
+        return;
     pieceMap.init(v);
     Bitboards::init_pieces();
 }
@@ -59,7 +64,18 @@ void init_variant(const Variant* v) {
 /// 'On change' actions, triggered by an option's value change
 void on_clear_hash(const Option&) { Search::clear(); }
 void on_hash_size(const Option& o) { TT.resize(size_t(o)); }
+void on_shared_hash(const Option&) { TT.resize(size_t(Options["Hash"])); }
+void on_large_pages(const Option& o) {
+    set_large_pages(o);
+    // Reallocate the tables and reload the network in the new kind of pages
+    TT.resize(size_t(Options["Hash"]));
+    Threads.set(size_t(Options["Threads"]));
+    Eval::eval_file_loaded = "None";
+    Eval::NNUE::init();
+    sync_cout << "info string " << large_pages_info() << sync_endl;
+}
 void on_logger(const Option& o) { start_logger(o); }
+void on_time_log(const Option& o) { start_time_log(o); }
 void on_threads(const Option& o) { Threads.set(size_t(o)); }
 void on_tb_path(const Option& o) { Tablebases::init(o); }
 
@@ -82,6 +98,10 @@ void on_variant_set(const Option &o) {
     const Variant* v = variants.find(o)->second;
     init_variant(v);
     PSQT::init(v);
+
+    // Shared hash tables are specific to a variant
+    if (std::string(Options["Shared Hash"]) != "<empty>")
+        TT.resize(size_t(Options["Hash"]));
 }
 void on_variant_change(const Option &o) {
     // Variant initialization
@@ -180,13 +200,19 @@ void init(OptionsMap& o) {
 
   o["Debug Log File"]        << Option("", on_logger);
   o["Threads"]               << Option(1, 1, 512, on_threads);
+  o["SMP Mode"]              << Option("Lazy", {"Lazy", "Breadcrumbs", "ABDADA"});
   o["Hash"]                  << Option(16, 1, MaxHashMB, on_hash_size);
   o["Clear Hash"]            << Option(on_clear_hash);
+  o["Shared Hash"]           << Option("<empty>", on_shared_hash);
+  o["Eval Hash"]             << Option(0, 0, 1024);
+  o["Eval Cache"]            << Option("Auto", {"Auto", "On", "Off"});
+  o["Large Pages"]           << Option("Auto", {"Auto", "Reserved", "Off"}, on_large_pages);
   o["Ponder"]                << Option(false);
   o["MultiPV"]               << Option(1, 1, 500);
   o["Skill Level"]           << Option(20, -20, 20);
   o["Move Overhead"]         << Option(10, 0, 5000);
   o["Slow Mover"]            << Option(100, 10, 1000);
+  o["Time Log"]              << Option("", on_time_log);
   o["nodestime"]             << Option(0, 0, 10000);
   o["UCI_Chess960"]          << Option(false);
   o["UCI_Variant"]           << Option("chess", variants.get_keys(), on_variant_change);
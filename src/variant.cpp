@@ -16,6 +16,8 @@
   along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <algorithm>
+#include <functional>
 #include <string>
 #include <iostream>
 #include <fstream>
@@ -1562,6 +1564,9 @@ void VariantMap::init() {
 
 
 /// VariantMap::parse_istream reads variants from an INI-style configuration input stream.
+/// Only the names, templates and board sizes of the variants are resolved here,
+/// the rules are parsed on first use by VariantMap::find(), unless checking the
+/// configuration. Reading a variant again with the same content is a no-op.
 
 template <bool DoCheck>
 void VariantMap::parse_istream(std::istream& file) {
@@ -1591,24 +1596,48 @@ void VariantMap::parse_istream(std::istream& file) {
             }
         }
 
+        // Hash of the content, including the one of the template
+        std::string content = variant_template + "\n";
+        auto th = contentHashes.find(variant_template);
+        if (th != contentHashes.end())
+            content += std::to_string(th->second) + "\n";
+        for (const auto& attrib : attribs)
+            content += attrib.first + "=" + attrib.second + "\n";
+        size_t hash = std::hash<std::string>()(content);
+
+        bool exists = count(variant) || pending.count(variant);
+        auto base = std::map<std::string, const Variant*>::find(variant_template);
+        auto pendingBase = pending.find(variant_template);
+
         // Create variant
-        if (variants.find(variant) != variants.end())
+        if (exists && !DoCheck && contentHashes.count(variant) && contentHashes[variant] == hash)
+            continue;
+        else if (exists)
             std::cerr << "Variant '" << variant << "' already exists." << std::endl;
-        else if (!variant_template.empty() && variants.find(variant_template) == variants.end())
+        else if (!variant_template.empty() && base == end() && pendingBase == pending.end())
             std::cerr << "Variant template '" << variant_template << "' does not exist." << std::endl;
+        else if (!DoCheck)
+        {
+            // Defer parsing the rules, but only register variants that fit on the board
+            Rank maxRank = base != end() ? base->second->maxRank : pendingBase != pending.end() ? pendingBase->second.maxRank : Variant().maxRank;
+            File maxFile = base != end() ? base->second->maxFile : pendingBase != pending.end() ? pendingBase->second.maxFile : Variant().maxFile;
+            if (VariantParser<DoCheck>(attribs).parse_board(maxRank, maxFile))
+            {
+                pending[variant] = { variant_template, attribs, maxRank, maxFile };
+                contentHashes[variant] = hash;
+            }
+        }
         else
         {
-            if (DoCheck)
-                std::cerr << "Parsing variant: " << variant << std::endl;
-            Variant* v = !variant_template.empty() ? VariantParser<DoCheck>(attribs).parse((new Variant(*variants.find(variant_template)->second))->init())
+            std::cerr << "Parsing variant: " << variant << std::endl;
+            Variant* v = !variant_template.empty() ? VariantParser<DoCheck>(attribs).parse((new Variant(*find(variant_template)->second))->init())
                                                    : VariantParser<DoCheck>(attribs).parse();
             if (v->maxFile <= FILE_MAX && v->maxRank <= RANK_MAX)
             {
                 add(variant, v);
                 // In order to allow inheritance, we need to temporarily add configured variants
                 // even when only checking them, but we remove them later after parsing is finished.
-                if (DoCheck)
-                    varsToErase.push_back(variant);
+                varsToErase.push_back(variant);
             }
             else
                 delete v;
@@ -1622,6 +1651,27 @@ void VariantMap::parse_istream(std::istream& file) {
     }
 }
 
+/// VariantMap::find() looks up a variant, parsing its rules if it has not been
+/// used before. Like the rest of the map, it must not be used concurrently with
+/// loading a configuration.
+
+VariantMap::iterator VariantMap::find(const std::string& s) {
+    iterator it = std::map<std::string, const Variant*>::find(s);
+    auto p = pending.find(s);
+    if (it != end() || p == pending.end())
+        return it;
+
+    PendingVariant pv = std::move(p->second);
+    pending.erase(p);
+
+    Config attribs = {};
+    attribs.insert(pv.attribs.begin(), pv.attribs.end());
+    Variant* v = !pv.variantTemplate.empty() ? VariantParser<false>(attribs).parse((new Variant(*find(pv.variantTemplate)->second))->init())
+                                             : VariantParser<false>(attribs).parse();
+    add(s, v);
+    return std::map<std::string, const Variant*>::find(s);
+}
+
 /// VariantMap::parse reads variants from an INI-style configuration file.
 
 template <bool DoCheck>
@@ -1642,6 +1692,8 @@ template void VariantMap::parse<true>(std::string path);
 template void VariantMap::parse<false>(std::string path);
 
 void VariantMap::add(std::string s, Variant* v) {
+  static size_t lastId = 0;
+  v->id = ++lastId;
   insert(std::pair<std::string, const Variant*>(s, v->conclude()));
 }
 
@@ -1649,12 +1701,17 @@ void VariantMap::clear_all() {
   for (auto const& element : *this)
       delete element.second;
   clear();
+  pending.clear();
+  contentHashes.clear();
 }
 
 std::vector<std::string> VariantMap::get_keys() {
   std::vector<std::string> keys;
   for (auto const& element : *this)
       keys.push_back(element.first);
+  for (auto const& element : pending)
+      keys.push_back(element.first);
+  std::sort(keys.begin(), keys.end());
   return keys;
 }
 
@@ -135,6 +135,7 @@ struct Variant {
   int connectN = 0;
   MaterialCounting materialCounting = NO_MATERIAL_COUNTING;
   CountingRule countingRule = NO_COUNTING;
+  bool evalCache = false;
 
   // Derived properties
   bool fastAttacks = true;
@@ -149,6 +150,12 @@ struct Variant {
   int nnueMaxPieces;
   bool endgameEval = false;
   bool shogiStylePromotions = false;
+  int packedPieceIndex[PIECE_TYPE_NB];
+  int packedPromotedIndex[PIECE_TYPE_NB];
+  std::vector<PieceType> packedPieceTypes;
+  int packedPieceBits;
+  int startKings[COLOR_NB]; // Kings of the starting position including the hands, for unpacked positions
+  size_t id = 0; // Unique among all loaded variants, unlike their addresses
 
   void add_piece(PieceType pt, char c, std::string betza = "", char c2 = ' ') {
       pieceToChar[make_piece(WHITE, pt)] = toupper(c);
@@ -258,15 +265,39 @@ struct Variant {
           kingSquareIndex[SQ_A1] = nnueKingSquare++ * nnuePieceIndices;
       nnueDimensions = nnueKingSquare * nnuePieceIndices;
 
+      // Enumerate pieces for the packed position format, where a square is encoded
+      // as empty (0) or by color and index of the piece type. Promoted shogi pieces
+      // are indexed by their unpromoted type, since e.g. tokin and promoted silver
+      // both are golds, but differ when captured.
+      packedPieceTypes.clear();
+      for (PieceType pt : pieceTypes)
+      {
+          packedPieceIndex[pt] = int(packedPieceTypes.size());
+          packedPieceTypes.push_back(pt);
+      }
+      for (PieceType pt : pieceTypes)
+          if (promotedPieceType[pt])
+          {
+              packedPromotedIndex[pt] = int(packedPieceTypes.size());
+              packedPieceTypes.push_back(pt);
+          }
+      packedPieceBits = 0;
+      while ((1 << packedPieceBits) <= 2 * int(packedPieceTypes.size()))
+          packedPieceBits++;
+
       // Determine maximum piece count
       std::istringstream ss(startFen);
       ss >> std::noskipws;
       unsigned char token;
       nnueMaxPieces = 0;
+      startKings[WHITE] = startKings[BLACK] = 0;
       while ((ss >> token) && !isspace(token))
       {
           if (pieceToChar.find(token) != std::string::npos || pieceToCharSynonyms.find(token) != std::string::npos)
               nnueMaxPieces++;
+          for (Color c : {WHITE, BLACK})
+              if (pieceTypes.count(KING) && token == pieceToChar[make_piece(c, KING)])
+                  startKings[c]++;
       }
       if (twoBoards)
           nnueMaxPieces *= 2;
@@ -307,11 +338,22 @@ public:
   void init();
   template <bool DoCheck> void parse(std::string path);
   template <bool DoCheck> void parse_istream(std::istream& file);
+  iterator find(const std::string& s);
   void clear_all();
   std::vector<std::string> get_keys();
 
 private:
+  // A configured variant that is only parsed on its first use
+  struct PendingVariant {
+    std::string variantTemplate;
+    std::map<std::string, std::string> attribs;
+    Rank maxRank;
+    File maxFile;
+  };
+
   void add(std::string s, Variant* v);
+  std::map<std::string, PendingVariant> pending;
+  std::map<std::string, size_t> contentHashes; // Of the configured variants
 };
 
 extern VariantMap variants;
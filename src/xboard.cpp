@@ -59,7 +59,7 @@ namespace XBoard {
 
     sync_cout << "Hint: " << UCI::move(pos, ponderMove) << sync_endl;
     ponderHighlight = highlight(UCI::square(pos, from_sq(ponderMove)));
-    do_move(ponderMove);
+    do_move(ponderMove, true);
     ponderMove = MOVE_NONE;
     go(limits, true);
   }
@@ -96,7 +96,7 @@ namespace XBoard {
 
   // do_move() is called when engine needs to apply a move when using XBoard protocol.
 
-  void StateMachine::do_move(Move m) {
+  void StateMachine::do_move(Move m, bool pondering) {
 
     // transfer states back
     if (Threads.setupStates.get())
@@ -107,6 +107,11 @@ namespace XBoard {
     moveList.push_back(m);
     states->emplace_back();
     pos.do_move(m, states->back());
+
+    // Keep a partner engine informed about our board, except for the
+    // hypothetical moves when pondering
+    if (!pondering)
+        Partner.send_board(pos);
   }
 
   // undo_move() is called when the engine receives the undo command in XBoard protocol.
@@ -468,6 +473,7 @@ void StateMachine::process_command(std::string token, std::istringstream& is) {
               // ponderhit
               moveAfterSearch = true;
               Threads.main()->ponder = false;
+              Partner.send_board(pos);
               return;
           }
       }
@@ -46,7 +46,7 @@ public:
   void ponder();
   void stop(bool abort = true);
   void setboard(std::string fen = "");
-  void do_move(Move m);
+  void do_move(Move m, bool pondering = false);
   void undo_move();
   std::string highlight(std::string square);
   void process_command(std::string token, std::istringstream& is);
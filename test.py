@@ -1,6 +1,8 @@
 # -*- coding: utf-8 -*-
 
 import faulthandler
+import io
+import random
 import unittest
 import pyffish as sf
 
@@ -249,6 +251,11 @@ class TestPyffish(unittest.TestCase):
         variants = sf.variants()
         self.assertTrue("shogun" in variants)
 
+        # Loading an unchanged configuration again keeps the variants as they are
+        sf.load_variant_config(ini_text)
+        self.assertEqual(sf.variants(), variants)
+        self.assertEqual(sf.start_fen("shogun"), "rnb+fkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNB+FKBNR[] w KQkq - 0 1")
+
     def test_set_option(self):
         result = sf.set_option("UCI_Variant", "capablanca")
         self.assertIsNone(result)
@@ -828,6 +835,23 @@ class TestPyffish(unittest.TestCase):
         result = sf.get_san_moves("shogun", SHOGUN, UCI_moves)
         self.assertEqual(result, SAN_moves)
 
+    def test_legal_moves_san(self):
+        # same as converting each legal move on its own
+        for variant, fen, moves, notation in (("chess", CHESS, ["e2e4", "e7e5", "g1f3", "b8c6", "b1c3", "g8f6"], sf.NOTATION_SAN),
+                                              ("crazyhouse", "r1b3nr/pppp1kpp/2n5/2b1p3/4P3/2N5/PPPP1PPP/R1B1K1NR/QPbq w KQ - 0 7", [], sf.NOTATION_LAN),
+                                              ("shogi", SHOGI, ["c3c4", "g7g6", "b2h8"], sf.NOTATION_SHOGI_HODGES),
+                                              ("xiangqi", XIANGQI, ["h3e3", "h10g8"], sf.NOTATION_XIANGQI_WXF)):
+            result = sf.legal_moves_san(variant, fen, moves, False, notation)
+            current = sf.get_fen(variant, fen, moves)
+            expected = [sf.get_san(variant, current, move, False, notation) for move in sf.legal_moves(variant, fen, moves)]
+            self.assertEqual(result, expected, variant)
+
+        # disambiguation and mate
+        result = sf.legal_moves_san("chess", "6k1/5ppp/8/8/8/8/8/R3R1K1 w - - 0 1", [])
+        self.assertIn("Rad1", result)
+        self.assertIn("Re8#", result)
+        self.assertIn("Kf1", result)
+
     def test_gives_check(self):
         result = sf.gives_check("capablanca", CAPA, [])
         self.assertFalse(result)
@@ -1063,5 +1087,203 @@ class TestPyffish(unittest.TestCase):
             fen = sf.start_fen(variant)
             self.assertEqual(sf.validate_fen(fen, variant), sf.FEN_OK, "{}: {}".format(variant, fen))
 
+    def test_validate_fens(self):
+        # same results as for single FENs
+        for variant, positions in list(variant_positions.items()) + list(invalid_variant_positions.items()):
+            fens = list(positions)
+            self.assertEqual(sf.validate_fens(fens, variant).tolist(), [sf.validate_fen(fen, variant) for fen in fens], variant)
+        self.assertEqual(sf.validate_fens([], "chess").tolist(), [])
+        self.assertEqual(sf.validate_fens([CHESS, "", CHESS + " 1"], "chess").tolist(), [sf.FEN_OK, 0, sf.validate_fen(CHESS + " 1", "chess")])
+        self.assertEqual(sf.validate_fens([CHESS960], "chess", True).tolist(), [sf.FEN_OK])
+        self.assertRaises(TypeError, sf.validate_fens, [CHESS, 1], "chess")
+
+    def test_get_packed(self):
+        # packed positions have a fixed size per variant
+        size = len(sf.get_packed("chess", CHESS, []))
+        self.assertEqual(len(sf.get_packed("chess", CHESS, ["e2e4", "e7e5", "g1f3"])), size)
+        self.assertRaises(ValueError, sf.unpack_fen, "chess", b"\0")
+        # unknown piece codes and squares
+        self.assertRaises(ValueError, sf.unpack_fen, "chess", b"\xff" * size)
+        # random data and bit flips of valid positions, accepted ones need to be usable
+        for variant in ("chess", "crazyhouse", "atomic", "shogi", "xiangqi", "seirawan"):
+            packed = sf.get_packed(variant, sf.start_fen(variant), [])
+            rng = random.Random(variant)
+            for i in range(1000):
+                if i % 4:
+                    data = bytearray(packed)
+                    for _ in range(rng.randint(1, 4)):
+                        bit = rng.randrange(8 * len(data))
+                        data[bit // 8] ^= 1 << (bit % 8)
+                else:
+                    data = bytearray(rng.getrandbits(8) for _ in range(len(packed)))
+                try:
+                    fen = sf.unpack_fen(variant, bytes(data))
+                except ValueError:
+                    continue
+                sf.legal_moves(variant, fen, [])
+
+        # round trip
+        for variant, positions in variant_positions.items():
+            for fen in positions:
+                expected = sf.get_fen(variant, fen, [])
+                self.assertEqual(sf.unpack_fen(variant, sf.get_packed(variant, fen, [])), expected, "{}: {}".format(variant, fen))
+
+        result = sf.unpack_fen("crazyhouse", sf.get_packed("crazyhouse", "startpos", ["e2e4", "d7d5", "e4d5", "d8d5", "b1c3", "d5a5", "P@d5"]))
+        self.assertEqual(result, sf.get_fen("crazyhouse", "startpos", ["e2e4", "d7d5", "e4d5", "d8d5", "b1c3", "d5a5", "P@d5"]))
+
+        result = sf.unpack_fen("shogi", sf.get_packed("shogi", SHOGI, ["c3c4", "d7d6", "b2g7+", "e9d8"]))
+        self.assertEqual(result, sf.get_fen("shogi", SHOGI, ["c3c4", "d7d6", "b2g7+", "e9d8"]))
+
+    def test_legal_moves_array(self):
+        for variant, positions in variant_positions.items():
+            for fen in positions:
+                moves = sf.legal_moves_array(variant, fen, [])
+                self.assertEqual(moves.format, "I")
+                self.assertEqual(len(moves), len(sf.legal_moves(variant, fen, [])), "{}: {}".format(variant, fen))
+                self.assertEqual(len(set(moves)), len(moves))
+
+                # the decoded moves match the UCI moves of the same index
+                files = sf.get_planes(variant, fen, []).shape[2]
+                pieces = sf.get_plane_pieces(variant)
+                square = lambda idx: "abcdefghijkl"[idx % files] + str(idx // files + 1)
+                for move, uci in zip(moves, sf.legal_moves(variant, fen, [])):
+                    origin, destination, move_type, piece = sf.decode_move(variant, move)
+                    message = "{}: {} {}".format(variant, fen, uci)
+                    if move_type == "drop":
+                        self.assertEqual(origin, -1, message)
+                        self.assertTrue(uci.startswith(pieces[piece] + "@" + square(destination)), message)
+                    else:
+                        self.assertTrue(uci.startswith(square(origin)), message)
+                        if move_type != "castling":
+                            self.assertTrue(uci[len(square(origin)):].startswith(square(destination)), message)
+                    if move_type == "promotion":
+                        self.assertTrue(uci.endswith(pieces[piece].lower()), message)
+                    elif move_type == "piece_promotion":
+                        self.assertTrue(uci.endswith("+"), message)
+                    elif move_type == "normal" and piece >= 0:
+                        self.assertTrue(uci.endswith(pieces[piece].lower()), message)
+        self.assertEqual(len(sf.legal_moves_array("chess", CHESS, ["f2f3", "e7e5", "g2g4", "d8h4"])), 0)
+        moves = sf.legal_moves_array("chess", CHESS, ["e2e4"])
+        self.assertEqual(sf.decode_move("chess", moves[sf.legal_moves("chess", CHESS, ["e2e4"]).index("e7e5")]), (52, 36, "normal", -1))
+        # castling moves go to the square of the rook
+        fen = "r3k2r/8/8/8/8/8/8/R3K2R w KQkq - 0 1"
+        moves = sf.legal_moves_array("chess", fen, [])
+        self.assertEqual(sf.decode_move("chess", moves[sf.legal_moves("chess", fen, []).index("e1g1")]), (4, 7, "castling", -1))
+        self.assertRaises(ValueError, sf.legal_moves_array, "chess", CHESS, ["e2e5"])
+
+    def test_get_planes(self):
+        self.assertEqual(sf.get_plane_pieces("chess"), ["P", "N", "B", "R", "Q", "K", "p", "n", "b", "r", "q", "k"])
+        planes = sf.get_planes("chess", CHESS, ["e2e4"])
+        self.assertEqual(planes.shape, (12, 8, 8))
+        self.assertEqual(planes.format, "b")
+        self.assertEqual(planes[0, 3, 4], 1)
+        self.assertEqual(planes[0, 1, 4], 0)
+        self.assertEqual(planes[11, 7, 4], 1)
+        self.assertEqual(sum(planes.tobytes()), 32)
+
+        # pocket planes are filled with the number of pieces in hand
+        pieces = sf.get_plane_pieces("crazyhouse")
+        planes = sf.get_planes("crazyhouse", "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR[PPn] w KQkq - 0 1", [])
+        self.assertEqual(planes.shape, (24, 8, 8))
+        self.assertEqual(planes.tolist()[12 + pieces.index("P")], [[2] * 8] * 8)
+        self.assertEqual(planes.tolist()[12 + pieces.index("n")], [[1] * 8] * 8)
+
+        planes = sf.get_planes("xiangqi", XIANGQI, [])
+        self.assertEqual(planes.shape, (14, 10, 9))
+        self.assertEqual(planes[sf.get_plane_pieces("xiangqi").index("k"), 9, 4], 1)
+
+    def test_replay_game(self):
+        fen = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 3+3 0 1"
+        moves = ["e2e4", "e7e5", "f1c4", "g8f6", "c4f7", "e8f7", "d1h5", "g7g6", "h5e5", "f8e7", "e5e7"]
+        fens, sans, checks, game_ends, results = sf.replay_game("3check", fen, moves)
+        self.assertEqual(sans, sf.get_san_moves("3check", fen, moves))
+        for ply in range(len(moves)):
+            self.assertEqual(fens[ply], sf.get_fen("3check", fen, moves[:ply + 1]))
+            self.assertEqual(checks[ply], sf.gives_check("3check", fen, moves[:ply + 1]))
+            game_end, result = sf.is_immediate_game_end("3check", fen, moves[:ply + 1])
+            self.assertEqual(game_ends[ply], game_end)
+            self.assertEqual(results[ply], result if game_end else 0)
+        self.assertEqual(sans[-1], "Qxe7#")
+        self.assertEqual(results[-1], -sf.VALUE_MATE)
+
+        result = sf.replay_game("shogi", SHOGI, ["c3c4", "g7g6"], False, sf.NOTATION_SHOGI_HODGES)
+        self.assertEqual(result[1], ["P-7f", "P-3d"])
+        self.assertEqual(sf.replay_game("chess", CHESS, []), ([], [], [], [], []))
+        self.assertRaises(ValueError, sf.replay_game, "chess", CHESS, ["e2e4", "e2e4"])
+
+    def test_read_pgn(self):
+        pgn = """[Event "Casual"]
+[Variant "Crazyhouse"]
+[Result "0-1"]
+
+1. e4 {comment} d5 2. exd5 (2. e5 c5 3. d4) Qxd5 $1 3. Nc3 Qa5 4. Bc4?! Nf6 5. d3 P@h3!? 0-1
+
+% escaped line
+[Event "Second"]
+[Result "1/2-1/2"]
+
+1.e4 e5 ; rest of line
+2.Nf3 Nc6 3.Qxf7 1/2-1/2
+[Variant "Chess960"]
+[FEN "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w HAha - 0 1"]
+
+1. e4 e5 2. Nf3 Nc6 3. Bc4 Bc5 4. O-O *"""
+        games = list(sf.read_pgn(io.StringIO(pgn)))
+        self.assertEqual(len(games), 3)
+
+        game = games[0]
+        self.assertEqual(game["headers"], {"Event": "Casual", "Variant": "Crazyhouse", "Result": "0-1"})
+        self.assertEqual(game["variant"], "crazyhouse")
+        self.assertEqual(game["moves"], ["e2e4", "d7d5", "e4d5", "d8d5", "b1c3", "d5a5", "f1c4", "g8f6", "d2d3", "P@h3"])
+        self.assertEqual(game["result"], "0-1")
+        self.assertIsNone(game["error"])
+
+        # replaying stops at illegal moves
+        game = games[1]
+        self.assertEqual(game["moves"], ["e2e4", "e7e5", "g1f3", "b8c6"])
+        self.assertEqual(game["result"], "1/2-1/2")
+        self.assertIn("Qxf7", game["error"])
+
+        game = games[2]
+        self.assertTrue(game["chess960"])
+        self.assertEqual(game["moves"], ["e2e4", "e7e5", "g1f3", "b8c6", "f1c4", "f8c5", "e1h1"])
+        self.assertEqual(game["result"], "*")
+
+        # castling with zeros
+        game = next(sf.read_pgn("1. e4 e5 2. Nf3 Nc6 3. Bc4 Bc5 4. 0-0 Nf6 5. d3 d6 6. Bg5 Bg4 7. Nc3 Qd7 8. a3 0-0-0 *"))
+        self.assertIsNone(game["error"])
+        self.assertEqual(game["moves"][6], "e1g1")
+        self.assertEqual(game["moves"][-1], "e8c8")
+
+        # buffers and files are equivalent to strings
+        self.assertEqual(list(sf.read_pgn(pgn)), games)
+        self.assertEqual(list(sf.read_pgn(pgn.encode())), games)
+        self.assertRaises(TypeError, sf.read_pgn, 1)
+
+    def test_search(self):
+        fen = "7k/8/6K1/8/8/8/8/Q7 w - - 0 1"
+        result = sf.search("chess", fen, [], "depth 6")
+        self.assertTrue(sf.get_san("chess", fen, result["bestmove"]).endswith("#"))
+        self.assertEqual(result["score"], "mate 1")
+        self.assertEqual(result["pv"][0], result["bestmove"])
+        self.assertGreater(result["nodes"], 0)
+
+        result = sf.search("crazyhouse", sf.start_fen("crazyhouse"), ["e2e4"], "nodes 1000")
+        self.assertIn(result["bestmove"], sf.legal_moves("crazyhouse", sf.start_fen("crazyhouse"), ["e2e4"]))
+
+        # no legal moves
+        result = sf.search("chess", "7k/5Q2/6K1/8/8/8/8/8 b - - 0 1", [])
+        self.assertEqual(result["bestmove"], "(none)")
+        self.assertEqual(result["score"], "cp 0")
+
+        # searches that only end on a stop command
+        for go in ["infinite", "", "movestogo 10"]:
+            with self.assertRaises(ValueError):
+                sf.search("chess", fen, [], go)
+
+    def test_arch(self):
+        self.assertIn(sf.arch, ["generic", "x86-64", "x86-64-sse41-popcnt", "x86-64-avx2", "x86-64-bmi2"])
+
+
 if __name__ == '__main__':
     unittest.main(verbosity=2)
@@ -0,0 +1,121 @@
+# Benchmark of the FEN validation of pyffish, optionally against another build,
+# e.g. of a previous revision:
+#
+#   git worktree add /tmp/base <revision> && (cd /tmp/base && python3 setup.py build_ext --inplace)
+#   python3 tests/fenbench.py /tmp/base
+#
+# usage: python3 tests/fenbench.py [<directory of another pyffish build>]
+
+import json
+import os
+import random
+import subprocess
+import sys
+import tempfile
+import time
+
+VARIANTS = ["chess", "crazyhouse", "3check", "seirawan", "shogi", "xiangqi", "makruk"]
+GAMES = 20
+MUTATIONS = 5
+REPEAT = 3
+
+
+def corpus(sf):
+    """FENs of random games, and the same FENs with some characters replaced, deleted or duplicated."""
+    rng = random.Random(1)
+    games, mutated = {}, {}
+    for variant in VARIANTS:
+        games[variant], mutated[variant] = [], []
+        for _ in range(GAMES):
+            start, moves = sf.start_fen(variant), []
+            for _ in range(80):
+                legal = sf.legal_moves(variant, start, moves)
+                if not legal:
+                    break
+                moves.append(rng.choice(legal))
+                fen = sf.get_fen(variant, start, moves)
+                games[variant].append(fen)
+                for _ in range(MUTATIONS):
+                    i = rng.randrange(len(fen))
+                    c = rng.choice("/[]-+~ 0123456789" + fen)
+                    mutated[variant].append(rng.choice([fen[:i] + c + fen[i + 1:], fen[:i] + fen[i + 1:], fen[:i] + fen[i] + fen[i:]]))
+    return {"games": games, "mutated": mutated}
+
+
+def measure(sf, fens):
+    """Results and timings of validate_fen, and of validate_fens if available."""
+    result = {}
+    for variant, batch in fens.items():
+        entry = {"fens": len(batch)}
+        t0 = time.perf_counter()
+        for _ in range(REPEAT):
+            entry["codes"] = [sf.validate_fen(fen, variant) for fen in batch]
+        entry["validate_fen"] = (time.perf_counter() - t0) / REPEAT
+        if hasattr(sf, "validate_fens"):
+            t0 = time.perf_counter()
+            for _ in range(REPEAT):
+                sf.validate_fens(batch, variant)
+            entry["validate_fens"] = (time.perf_counter() - t0) / REPEAT
+        result[variant] = entry
+    return result
+
+
+def import_pyffish(path):
+    sys.path.insert(0, path)
+    import pyffish
+    return pyffish
+
+
+def run(path, corpusFile, resultFile):
+    """Measures the pyffish build in path, with the reasons of invalid FENs on stderr discarded."""
+    sf = import_pyffish(path)
+    with open(corpusFile) as f:
+        fens = json.load(f)
+    devnull = os.open(os.devnull, os.O_WRONLY)
+    os.dup2(devnull, 2)
+    result = measure(sf, fens)
+    with open(resultFile, "w") as f:
+        json.dump(result, f)
+
+
+def rate(count, seconds):
+    return "{:>8.0f}k/s".format(count / seconds / 1000) if seconds else "{:>10}".format("-")
+
+
+def main():
+    root = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+    builds = [("this", root)] + [("other", os.path.abspath(path)) for path in sys.argv[1:2]]
+    with tempfile.TemporaryDirectory() as tmp:
+        corpora = corpus(import_pyffish(root))
+        # Each build and corpus is measured in a process of its own, so that a build can crash on a corpus
+        results = {}
+        for kind, fens in corpora.items():
+            corpusFile = os.path.join(tmp, kind + ".json")
+            with open(corpusFile, "w") as f:
+                json.dump(fens, f)
+            for name, path in builds:
+                resultFile = os.path.join(tmp, name + "-" + kind + ".json")
+                if subprocess.run([sys.executable, __file__, "--run", path, corpusFile, resultFile]).returncode == 0:
+                    with open(resultFile) as f:
+                        results[name, kind] = json.load(f)
+
+    print("{:<10}{:<12}{:>7}".format("fens", "variant", "count") + "".join("{:>14}{:>14}".format(name + " fen", name + " fens") for name, _ in builds))
+    for kind, fens in corpora.items():
+        for variant in VARIANTS:
+            line = "{:<10}{:<12}{:>7}".format(kind, variant, len(fens[variant]))
+            entries = [results.get((name, kind), {}).get(variant) for name, _ in builds]
+            for entry in entries:
+                if entry:
+                    line += "{:>14}{:>14}".format(rate(entry["fens"], entry["validate_fen"]), rate(entry["fens"], entry.get("validate_fens")))
+                else:
+                    line += "{:>28}".format("crashed")
+            if any(entry and entry["codes"] != entries[0]["codes"] for entry in entries):
+                line += "  different results"
+            print(line)
+
+
+if __name__ == "__main__":
+    if sys.argv[1:2] == ["--run"]:
+        run(*sys.argv[2:5])
+    else:
+        main()
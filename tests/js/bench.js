@@ -0,0 +1,74 @@
+// Benchmark of ffish.js to compare builds
+//
+// usage: node bench.js
+
+const ffish = require('./ffish.js');
+const { performance } = require('perf_hooks');
+
+const positions = [
+  ["chess", "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 10"],
+  ["chess", "4rrk1/pp1n3p/3q2pQ/2p1pb2/2PP4/2P3N1/P2B2PP/4RRK1 b - - 7 19"],
+  ["crazyhouse", "r1b1k2r/ppp2ppp/2n5/3np3/3P4/2PBP3/P4PPP/R1BQK1NR[QPbn] w KQkq - 0 9"],
+  ["shogi", "lnsgkgsnl/1r5b1/pppppp1pp/6p2/9/2P6/PP1PPPPPP/1B5R1/LNSGKGSNL[-] w - - 0 2"],
+  ["xiangqi", "r1bakabr1/9/1cn3nc1/p1p1p1p1p/9/9/P1P1P1P1P/1CN3NC1/9/R1BAKABR1 w - - 4 3"],
+];
+
+function time(name, count, unit, f) {
+  const t0 = performance.now();
+  f();
+  const ms = performance.now() - t0;
+  console.log(`${name.padEnd(14)} ${ms.toFixed(0).padStart(6)} ms ${Math.round(count * 1000 / ms).toString().padStart(10)} ${unit}/second`);
+}
+
+ffish['onRuntimeInitialized'] = () => {
+  console.log(ffish.info());
+
+  let moves = 0;
+  time("legalMoves", 100 * positions.length, "calls", () => {
+    for (const [variant, fen] of positions) {
+      const board = new ffish.Board(variant, fen);
+      for (let i = 0; i < 100; ++i)
+        moves += board.numberLegalMoves() + board.legalMoves().length;
+      board.delete();
+    }
+  });
+
+  time("legalMovesSan", 100 * positions.length, "calls", () => {
+    for (const [variant, fen] of positions) {
+      const board = new ffish.Board(variant, fen);
+      for (let i = 0; i < 100; ++i)
+        moves += board.legalMovesSan().length;
+      board.delete();
+    }
+  });
+
+  // A game of random moves, replayed repeatedly
+  const game = [];
+  {
+    const board = new ffish.Board("crazyhouse");
+    for (let ply = 0; ply < 200 && !board.isGameOver(); ++ply) {
+      const legal = board.legalMoves().split(" ");
+      const move = legal[(ply * 7919) % legal.length];
+      game.push(move);
+      board.push(move);
+    }
+    board.delete();
+  }
+  time("replayGame", 100 * game.length, "plies", () => {
+    for (let i = 0; i < 100; ++i)
+      ffish.replayGame("crazyhouse", "", game.join(" "));
+  });
+
+  // FENs of the replayed game, validated one by one and as a batch
+  const fens = ffish.replayGame("crazyhouse", "", game.join(" ")).fens;
+  time("validateFen", 100 * fens.length, "fens", () => {
+    for (let i = 0; i < 100; ++i)
+      for (const fen of fens)
+        ffish.validateFen(fen, "crazyhouse");
+  });
+  const fenBatch = fens.join("\n");
+  time("validateFens", 100 * fens.length, "fens", () => {
+    for (let i = 0; i < 100; ++i)
+      ffish.validateFens(fenBatch, "crazyhouse");
+  });
+};
@@ -103,6 +103,56 @@ describe('board.legalMovesSan()', function () {
     chai.expect(board.legalMovesSan().split(' ').sort().join()).to.equal(expectedMoves.split(' ').sort().join());
     board.delete();
   });
+  it("it disambiguates moves and marks checkmates", () => {
+    const board = new ffish.Board("chess", "6k1/5ppp/8/8/8/8/8/R3R1K1 w - - 0 1");
+    const moves = board.legalMovesSan().split(' ');
+    chai.expect(moves).to.include.members(["Rad1", "Red1", "Re8#", "Kf1"]);
+    chai.expect(moves).to.not.include("Rd1");
+    board.delete();
+  });
+});
+
+describe('board.legalMovesArray()', function () {
+  it("it returns all legal moves as packed moves in a Uint32Array", () => {
+    const board = new ffish.Board("crazyhouse", "r1b3nr/pppp1kpp/2n5/2b1p3/4P3/2N5/PPPP1PPP/R1B1K1NR/QPbq w KQ - 0 7");
+    const moves = board.legalMovesArray().slice();
+    chai.expect(moves).to.be.an.instanceof(Uint32Array);
+    chai.expect(moves.length).to.equal(90);
+    chai.expect(new Set(moves).size).to.equal(90);
+    const idx = board.legalMoves().split(" ").indexOf("e1e2");
+    board.push("e1e2");
+    chai.expect(Array.from(board.moveStackArray())).to.deep.equal([moves[idx]]);
+    board.delete();
+  });
+});
+
+describe('ffish.decodeMove(uciVariant, move)', function () {
+  it("it returns the squares, type and piece of a packed move", () => {
+    const board = new ffish.Board("crazyhouse", "r1b3nr/pppp1kpp/2n5/2b1p3/4P3/2N5/PPPP1PPP/R1B1K1NR/QPbq w KQ - 0 7");
+    const pieces = ffish.planePieces("crazyhouse").split(" ");
+    const moves = board.legalMovesArray().slice();
+    const uci = board.legalMoves().split(" ");
+    chai.expect(ffish.decodeMove("crazyhouse", moves[uci.indexOf("e1e2")])).to.deep.equal({from: 4, to: 12, type: "normal", piece: -1});
+    chai.expect(ffish.decodeMove("crazyhouse", moves[uci.indexOf("Q@f3")])).to.deep.equal({from: -1, to: 21, type: "drop", piece: pieces.indexOf("Q")});
+    board.delete();
+  });
+});
+
+describe('board.planes()', function () {
+  it("it returns the piece and pocket planes in an Int8Array", () => {
+    const board = new ffish.Board("crazyhouse", "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR[PPn] w KQkq - 0 1");
+    const pieces = ffish.planePieces("crazyhouse").split(" ");
+    chai.expect(pieces).to.deep.equal(["P", "N", "B", "R", "Q", "K", "p", "n", "b", "r", "q", "k"]);
+    const planes = board.planes();
+    chai.expect(planes).to.be.an.instanceof(Int8Array);
+    chai.expect(planes.length).to.equal(24 * 64);
+    const king = pieces.indexOf("K") * 64;
+    chai.expect(planes[king + 4]).to.equal(1);
+    chai.expect(planes.slice(king, king + 64).reduce((a, b) => a + b)).to.equal(1);
+    const pawnsInHand = (12 + pieces.indexOf("P")) * 64;
+    chai.expect(Array.from(planes.slice(pawnsInHand, pawnsInHand + 64))).to.deep.equal(Array(64).fill(2));
+    board.delete();
+  });
 });
 
 describe('board.numberLegalMoves()', function () {
@@ -218,6 +268,35 @@ describe('board.setFen(fen)', function () {
   });
 });
 
+describe('board.pack()', function () {
+  it("it returns the position in a compact binary encoding of fixed size per variant", () => {
+    let board = new ffish.Board();
+    const packed = board.pack();
+    chai.expect(packed).to.be.an.instanceof(Uint8Array);
+    board.push("e2e4");
+    chai.expect(board.pack().length).to.equal(packed.length);
+    board.delete();
+    board = new ffish.Board("shogi");
+    chai.expect(board.pack().length).to.not.equal(packed.length);
+    board.delete();
+  });
+});
+
+describe('board.setPacked(packed)', function () {
+  it("it sets the position from its packed encoding", () => {
+    let board = new ffish.Board("crazyhouse", "r1bqk2r/ppp2ppp/2n5/3pP3/1b1Pn3/2NB1N2/PPP2PPP/R1BQK2R[Pp] w KQkq d6 0 8");
+    const packed = board.pack();
+    let board2 = new ffish.Board("crazyhouse");
+    chai.expect(board2.setPacked(packed)).to.equal(true);
+    chai.expect(board2.fen()).to.equal("r1bqk2r/ppp2ppp/2n5/3pP3/1b1Pn3/2NB1N2/PPP2PPP/R1BQK2R[Pp] w KQkq d6 0 8");
+    chai.expect(board2.setPacked(new Uint8Array(1))).to.equal(false);
+    chai.expect(board2.setPacked(new Uint8Array(packed.length).fill(255))).to.equal(false);
+    chai.expect(board2.fen()).to.equal("r1bqk2r/ppp2ppp/2n5/3pP3/1b1Pn3/2NB1N2/PPP2PPP/R1BQK2R[Pp] w KQkq d6 0 8");
+    board.delete();
+    board2.delete();
+  });
+});
+
 describe('board.sanMove(uciMove)', function () {
   it("it converts an uci move into san", () => {
     const board = new ffish.Board();
@@ -540,6 +619,39 @@ describe('board.pushSanMoves(sanMoves, notation)', function () {
     chai.expect(board.fen()).to.equal("rnbqkbnr/pppp1ppp/8/4p3/4P3/5N2/PPPP1PPP/RNBQKB1R b KQkq - 1 2");
     board.delete();
   });
+  it("it supports other notations and rejects moves missing the promotion suffix", () => {
+    let board = new ffish.Board("shogi");
+    board.pushSanMoves("P-76 P-34 Bx22+ Sx22 B*45", ffish.Notation.SHOGI_HODGES_NUMBER);
+    chai.expect(board.fen()).to.equal("lnsgkg1nl/1r5s1/pppppp1pp/6p2/5B3/2P6/PP1PPPPPP/7R1/LNSGKGSNL[b] b - - 1 3");
+    chai.expect(board.pushSan("Bx22", ffish.Notation.SHOGI_HODGES_NUMBER)).to.equal(false);
+    board.delete();
+    let board2 = new ffish.Board("xiangqi");
+    board2.pushSanMoves("C2=5 H8+7 H2+3 R9=8", ffish.Notation.XIANGQI_WXF);
+    chai.expect(board2.fen()).to.equal("rnbakabr1/9/1c4nc1/p1p1p1p1p/9/9/P1P1P1P1P/1C2C1N2/9/RNBAKAB1R w - - 4 3");
+    board2.delete();
+  });
+});
+
+describe('board.replayGame(uciMoves)', function () {
+  it("it pushes the moves and returns the FEN, SAN, check and game end status per ply", () => {
+    let board = new ffish.Board("3check", "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 3+3 0 1");
+    const replay = board.replayGame("e2e4 e7e5 f1c4 g8f6 c4f7 e8f7 d1h5 g7g6 h5e5 f8e7 e5e7");
+    chai.expect(replay.sans).to.deep.equal(["e4", "e5", "Bc4", "Nf6", "Bxf7+", "Kxf7", "Qh5+", "g6", "Qxe5", "Be7", "Qxe7#"]);
+    chai.expect(replay.fens[10]).to.equal(board.fen());
+    chai.expect(Array.from(replay.checks)).to.deep.equal([0, 0, 0, 0, 1, 0, 1, 0, 0, 0, 1]);
+    chai.expect(Array.from(replay.gameEnds)).to.deep.equal([0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1]);
+    chai.expect(replay.results[10]).to.equal(-32000);
+    chai.expect(board.moveStack().split(" ").length).to.equal(11);
+    board.delete();
+  });
+});
+
+describe('ffish.replayGame(uciVariant, fen, uciMoves)', function () {
+  it("it replays a game once and returns the FEN, SAN, check and game end status per ply", () => {
+    const replay = ffish.replayGame("shogi", "", "c3c4 g7g6", false, ffish.Notation.SHOGI_HODGES);
+    chai.expect(replay.sans).to.deep.equal(["P-7f", "P-3d"]);
+    chai.expect(replay.fens[1]).to.equal("lnsgkgsnl/1r5b1/pppppp1pp/6p2/9/2P6/PP1PPPPPP/1B5R1/LNSGKGSNL[] w - - 2 2");
+  });
 });
 
 describe('board.pocket(turn)', function () {
@@ -744,6 +856,18 @@ describe('ffish.validateFen(fen, uciVariant)', function () {
     });
 });
 
+describe('ffish.validateFens(fens, uciVariant)', function () {
+  it("it validates newline separated FENs and returns the error codes as an Int8Array", () => {
+    const fens = ["rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", "",
+                  "rnbqkknr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"];
+    const result = ffish.validateFens(fens.join("\n"), "chess");
+    chai.expect(result).to.be.an.instanceof(Int8Array);
+    chai.expect(Array.from(result)).to.deep.equal(fens.map(fen => ffish.validateFen(fen, "chess")));
+    chai.expect(ffish.validateFens("", "chess").length).to.equal(0);
+    chai.expect(Array.from(ffish.validateFens("nrbqbkrn/pppppppp/8/8/8/8/PPPPPPPP/NRBQBKRN w BGbg - 0 1\n", "chess", true))).to.deep.equal([1]);
+  });
+});
+
 describe('ffish.validateFen(fen, uciVariant, chess960)', function () {
   it("it validates a given X-FEN and returns +1 if fen is valid. Otherwise an error code will be returned.", () => {
     chai.expect(ffish.validateFen("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w AHah - 0 1", "chess", true)).to.equal(1);
@@ -789,6 +913,44 @@ describe('ffish.readGamePGN(pgn)', function () {
   });
 });
 
+describe('ffish.PgnReader', function () {
+  it("it reads many games from a pgn stream fed in chunks", () => {
+     fs = require('fs');
+     let pgnFiles = ['deep_blue_kasparov_1997.pgn', 'lichess_pgn_2018.12.21_JannLee_vs_CrazyAra.j9eQS4TF.pgn', 'c60_ruy_lopez.pgn']
+     let expectedFens = ["1r6/5kp1/RqQb1p1p/1p1PpP2/1Pp1B3/2P4P/6P1/5K2 b - - 14 45",
+                         "3r2kr/2pb1Q2/4ppp1/3pN2p/1P1P4/3PbP2/P1P3PP/6NK[PPqrrbbnn] b - - 1 37",
+                         "r1bqkbnr/pppp1ppp/2n5/1B2p3/4P3/5N2/PPPP1PPP/RNBQK2R b KQkq - 3 3"]
+     let pgn = pgnFiles.map(file => fs.readFileSync(pgnDir + file, 'utf8')).join("\n\n");
+     let reader = new ffish.PgnReader();
+     let fens = [];
+     for (let idx = 0; idx < pgn.length; idx += 100) {
+       reader.feed(pgn.substring(idx, idx + 100));
+       while (reader.hasNext()) {
+         let game = reader.next();
+         let board = new ffish.Board(game.headers("Variant").toLowerCase());
+         board.pushMoves(game.mainlineMoves());
+         fens.push(board.fen());
+         board.delete();
+         game.delete();
+       }
+     }
+     reader.finish();
+     chai.expect(reader.hasNext()).to.equal(false);
+     chai.expect(fens).to.deep.equal(expectedFens);
+     reader.delete();
+  });
+  it("it reports the first invalid move and keeps the moves before it", () => {
+     let reader = new ffish.PgnReader();
+     reader.feed('[Event "?"]\n\n1. e4 e5 2. Ke2 Ke7 3. Kxe7 1-0\n');
+     reader.finish();
+     let game = reader.next();
+     chai.expect(game.error()).to.equal("Invalid move 'Kxe7' in position 'rnbq1bnr/ppppkppp/8/4p3/4P3/8/PPPPKPPP/RNBQ1BNR w - - 2 3'");
+     chai.expect(game.mainlineMoves()).to.equal("e2e4 e7e5 e1e2 e8e7");
+     game.delete();
+     reader.delete();
+  });
+});
+
 describe('game.headerKeys()', function () {
   it("it returns all available header keys of the loaded game", () => {
      fs = require('fs');
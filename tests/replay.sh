@@ -0,0 +1,58 @@
+#!/bin/bash
+# measure the throughput of replaying move lists with the position command
+#
+# usage: tests/replay.sh [repetitions] [plies] [variants...]
+
+error()
+{
+  echo "replay testing failed on line $1"
+  exit 1
+}
+trap 'error ${LINENO}' ERR
+
+repetitions=${1:-200}
+plies=${2:-300}
+shift 2 2>/dev/null || true
+variants=${@:-crazyhouse shogi}
+
+echo "replay testing started: $repetitions repetitions, up to $plies plies"
+
+for variant in $variants; do
+  # generate a game by fast self-play
+  coproc SF { ./stockfish 2>&1; }
+  echo "setoption name UCI_Variant value $variant" >&${SF[1]}
+  moves=""
+  for ((ply = 0; ply < plies; ply++)); do
+    printf "position startpos moves $moves\ngo depth 1\n" >&${SF[1]}
+    while read -r line <&${SF[0]}; do
+      [[ $line == bestmove* ]] && break
+    done
+    move=`echo $line | awk '{print $2}'`
+    [[ $move == "(none)" || $move == "resign" ]] && break
+    moves="$moves $move"
+  done
+  printf "position startpos moves $moves\nd\n" >&${SF[1]}
+  while read -r line <&${SF[0]}; do
+    [[ $line == Fen:* ]] && break
+  done
+  expected=$line
+  echo "quit" >&${SF[1]}
+  wait $SF_PID 2>/dev/null || true
+
+  # replay the full game repeatedly, excluding the startup time
+  count=`echo $moves | wc -w`
+  start=`date +%s%N`
+  printf "setoption name UCI_Variant value $variant\nposition startpos\nquit\n" | ./stockfish > /dev/null 2>&1
+  startup=$(( `date +%s%N` - start ))
+  start=`date +%s%N`
+  result=`(echo "setoption name UCI_Variant value $variant"
+           for ((i = 0; i < repetitions; i++)); do echo "position startpos moves $moves"; done
+           printf "d\nquit\n") | ./stockfish 2>&1 | grep "^Fen:"`
+  end=`date +%s%N`
+  [[ $result == "$expected" ]]
+
+  ms=$(( (end - start - startup) / 1000000 ))
+  printf "%-12s %4d plies  time %6d ms  moves/second %10d\n" $variant $count $ms $(( count * repetitions * 1000 / (ms > 0 ? ms : 1) ))
+done
+
+echo "replay testing OK"
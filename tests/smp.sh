@@ -0,0 +1,29 @@
+#!/bin/bash
+# compare the SMP modes by the time to reach a fixed depth for a set of variants
+#
+# usage: tests/smp.sh [threads] [depth] [variants...]
+
+error()
+{
+  echo "smp testing failed on line $1"
+  exit 1
+}
+trap 'error ${LINENO}' ERR
+
+threads=${1:-4}
+depth=${2:-16}
+shift 2 2>/dev/null || true
+variants=${@:-chess crazyhouse shogi}
+
+echo "smp testing started: $threads threads, depth $depth"
+
+for variant in $variants; do
+  for mode in Lazy Breadcrumbs ABDADA; do
+    result=`printf "setoption name SMP Mode value $mode\nbench $variant 64 $threads $depth default depth\nquit\n" \
+            | ./stockfish 2>&1 | grep -E "Total time|Nodes/second" | awk '{print $NF}' | tr '\n' ' '`
+    set -- $result
+    printf "%-12s %-12s time %8s ms  nps %10s\n" $variant $mode $1 $2
+  done
+done
+
+echo "smp testing OK"